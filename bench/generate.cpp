@@ -0,0 +1,64 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "InstanceGenerator.h"
+#include "smti.h"
+
+// Measures how fast random instances are generated, with the generator that
+// takes a std::mt19937 (skipped if the size is above old_max, or for other
+// families than uniform) and with the seeded generator using one thread and
+// the given number of threads. For families other than uniform, tie_density
+// is the tie width.
+int main(int argc, char *argv[]) {
+  if (argc < 4) {
+    std::cout << "Usage: bench_generate <size> <pref_length> <tie_density> [threads] [old_max] "
+              << "[uniform|master|euclidean|popularity|grp]" << std::endl;
+    return 1;
+  }
+  int size = atoi(argv[1]);
+  int pref_length = atoi(argv[2]);
+  float tie_density = atof(argv[3]);
+  int threads = (argc > 4) ? atoi(argv[4]) : 0;
+  int old_max = (argc > 5) ? atoi(argv[5]) : 20000;
+  std::string family = (argc > 6) ? argv[6] : "uniform";
+
+  InstanceGenerator::Shape shape;
+  shape.tie_density = tie_density;
+  shape.tie_width = tie_density;
+  if (family == "master") {
+    shape.family = InstanceGenerator::MasterList;
+    shape.noise = 0.2;
+  } else if (family == "euclidean") {
+    shape.family = InstanceGenerator::Euclidean;
+  } else if (family == "popularity") {
+    shape.family = InstanceGenerator::Popularity;
+    shape.noise = 0.2;
+  } else if (family == "grp") {
+    shape.family = InstanceGenerator::GRP;
+  } else if (family != "uniform") {
+    std::cerr << "Unknown family " << family << std::endl;
+    return 1;
+  }
+  InstanceGenerator generator(size, pref_length, shape, 1);
+
+  std::cout << "size\tmt19937_ms\tseeded_ms\tparallel_ms" << std::endl;
+  double old_ms = -1;
+  if ((size <= old_max) && (family == "uniform")) {
+    std::mt19937 g(1);
+    auto start = std::chrono::steady_clock::now();
+    SMTI instance(size, pref_length, tie_density, g);
+    old_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+  auto start = std::chrono::steady_clock::now();
+  SMTI sequential(generator, 1);
+  auto middle = std::chrono::steady_clock::now();
+  SMTI parallel(generator, threads);
+  auto end = std::chrono::steady_clock::now();
+  std::cout << size << "\t" << old_ms << "\t"
+            << std::chrono::duration<double, std::milli>(middle - start).count() << "\t"
+            << std::chrono::duration<double, std::milli>(end - middle).count() << std::endl;
+  return 0;
+}
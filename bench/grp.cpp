@@ -0,0 +1,58 @@
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+#include "smti.h"
+
+// Compares solving GRP instances through the global order of pairs with
+// solving them with the generic IP. Instances are dense score matrices like
+// test/grp-test-*.instance, with integer scores from 0 to max_score, so
+// that a smaller max_score gives more ties.
+int main(int argc, char *argv[]) {
+  if (argc < 4) {
+    std::cout << "Usage: bench_grp <size> <max_score> <threshold> [repeats]" << std::endl;
+    return 1;
+  }
+  int size = atoi(argv[1]);
+  int max_score = atoi(argv[2]);
+  int threshold = atoi(argv[3]);
+  int repeats = (argc > 4) ? atoi(argv[4]) : 5;
+
+  std::mt19937 g(1);
+  std::uniform_int_distribution<int> score(0, max_score);
+  std::filesystem::path filename = std::filesystem::temp_directory_path() / "bench_grp.instance";
+
+  std::cout << "repeat\tforced\tsize\tgrp_ms\tgeneric_ms" << std::endl;
+  for(int repeat = 1; repeat <= repeats; ++repeat) {
+    {
+      std::ofstream out(filename);
+      out << size << "\n" << size << "\n";
+      for(int row = 0; row < size; ++row) {
+        for(int col = 0; col < size; ++col) {
+          out << score(g) << ((col + 1 < size) ? " " : "\n");
+        }
+      }
+    }
+    SMTI instance = SMTI::create_from_GRP(filename.string(), threshold);
+    auto start = std::chrono::steady_clock::now();
+    size_t forced = instance.GRP_forced_pairs().size();
+    Matching grp = instance.solve_GRP();
+    auto middle = std::chrono::steady_clock::now();
+    SMTI::IP_Model model(&instance);
+    Matching generic = model.solve();
+    auto end = std::chrono::steady_clock::now();
+    if (grp.size() != generic.size()) {
+      std::cerr << "Found " << grp.size() << " pairs through the global order, and "
+                << generic.size() << " with the generic IP" << std::endl;
+      return 1;
+    }
+    std::cout << repeat << "\t" << forced << "\t" << grp.size() << "\t"
+              << std::chrono::duration<double, std::milli>(middle - start).count() << "\t"
+              << std::chrono::duration<double, std::milli>(end - middle).count() << std::endl;
+  }
+  std::filesystem::remove(filename);
+  return 0;
+}
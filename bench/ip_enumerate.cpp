@@ -0,0 +1,45 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+#include "smti.h"
+
+// Compares the time to find all stable matchings of random instances
+// sequentially and with the parallel partitioned enumeration.
+int main(int argc, char *argv[]) {
+  if (argc < 4) {
+    std::cout << "Usage: bench_ip_enumerate <size> <pref_length> <tie_density> [threads] [num_seeds]" << std::endl;
+    return 1;
+  }
+  int size = atoi(argv[1]);
+  int pref_length = atoi(argv[2]);
+  float tie_density = atof(argv[3]);
+  int threads = (argc > 4) ? atoi(argv[4]) : 0;
+  int num_seeds = (argc > 5) ? atoi(argv[5]) : 5;
+
+  std::cout << "seed\tmatchings\tsequential_ms\tparallel_ms\tspeedup" << std::endl;
+  for(int seed = 1; seed <= num_seeds; ++seed) {
+    std::mt19937 g(seed);
+    SMTI instance(size, pref_length, tie_density, g);
+
+    auto start = std::chrono::steady_clock::now();
+    SMTI::IP_Model sequential(&instance);
+    std::list<Matching> sequential_matchings = sequential.find_all_stable_matchings();
+    auto middle = std::chrono::steady_clock::now();
+    SMTI::IP_Model parallel(&instance);
+    std::list<Matching> parallel_matchings = parallel.find_all_stable_matchings(threads);
+    auto end = std::chrono::steady_clock::now();
+
+    if (sequential_matchings.size() != parallel_matchings.size()) {
+      std::cerr << "Counts differ for seed " << seed << ": " << sequential_matchings.size()
+                << " and " << parallel_matchings.size() << std::endl;
+      return 1;
+    }
+    double sequential_ms = std::chrono::duration<double, std::milli>(middle - start).count();
+    double parallel_ms = std::chrono::duration<double, std::milli>(end - middle).count();
+    std::cout << seed << "\t" << sequential_matchings.size() << "\t" << sequential_ms << "\t"
+              << parallel_ms << "\t" << sequential_ms / parallel_ms << std::endl;
+  }
+  return 0;
+}
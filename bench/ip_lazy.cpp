@@ -0,0 +1,49 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+#include "smti.h"
+
+// Compares the time taken to solve random instances with all stability
+// constraints added up front against adding them lazily.
+int main(int argc, char *argv[]) {
+  if (argc < 4) {
+    std::cout << "Usage: bench_ip_lazy <size> <pref_length> <tie_density> [num_seeds]" << std::endl;
+    return 1;
+  }
+  int size = atoi(argv[1]);
+  int pref_length = atoi(argv[2]);
+  float tie_density = atof(argv[3]);
+  int num_seeds = (argc > 4) ? atoi(argv[4]) : 5;
+
+  std::cout << "seed\tmerged\tfull_ms\tlazy_ms\tsize" << std::endl;
+  for(int seed = 1; seed <= num_seeds; ++seed) {
+    for(bool merged: {true, false}) {
+      std::mt19937 g(seed);
+      SMTI instance(size, pref_length, tie_density, g);
+
+      auto start = std::chrono::steady_clock::now();
+      SMTI::IP_Model full(&instance);
+      full.merge(merged);
+      Matching full_matching = full.solve();
+      auto middle = std::chrono::steady_clock::now();
+      SMTI::IP_Model lazy(&instance);
+      lazy.merge(merged);
+      lazy.lazy(true);
+      Matching lazy_matching = lazy.solve();
+      auto end = std::chrono::steady_clock::now();
+
+      if (full_matching.size() != lazy_matching.size()) {
+        std::cerr << "Sizes differ for seed " << seed << ": " << full_matching.size()
+                  << " and " << lazy_matching.size() << std::endl;
+        return 1;
+      }
+      std::cout << seed << "\t" << merged << "\t"
+                << std::chrono::duration<double, std::milli>(middle - start).count() << "\t"
+                << std::chrono::duration<double, std::milli>(end - middle).count() << "\t"
+                << full_matching.size() << std::endl;
+    }
+  }
+  return 0;
+}
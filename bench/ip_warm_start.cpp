@@ -0,0 +1,48 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+#include "smti.h"
+
+// Compares the time to optimality for random instances with and without a
+// starting solution from the Gale-Shapley heuristic. The time for the
+// heuristic itself is included.
+int main(int argc, char *argv[]) {
+  if (argc < 4) {
+    std::cout << "Usage: bench_ip_warm_start <size> <pref_length> <tie_density> [num_seeds]" << std::endl;
+    return 1;
+  }
+  int size = atoi(argv[1]);
+  int pref_length = atoi(argv[2]);
+  float tie_density = atof(argv[3]);
+  int num_seeds = (argc > 4) ? atoi(argv[4]) : 5;
+
+  std::cout << "seed\tcold_ms\twarm_ms\theuristic_size\tsize" << std::endl;
+  for(int seed = 1; seed <= num_seeds; ++seed) {
+    std::mt19937 g(seed);
+    SMTI instance(size, pref_length, tie_density, g);
+
+    auto start = std::chrono::steady_clock::now();
+    SMTI::IP_Model cold(&instance);
+    Matching cold_matching = cold.solve();
+    auto middle = std::chrono::steady_clock::now();
+    std::mt19937 heuristic_generator(seed);
+    Matching heuristic = instance.gale_shapley(heuristic_generator);
+    SMTI::IP_Model warm(&instance);
+    warm.warm_start(heuristic);
+    Matching warm_matching = warm.solve();
+    auto end = std::chrono::steady_clock::now();
+
+    if (cold_matching.size() != warm_matching.size()) {
+      std::cerr << "Sizes differ for seed " << seed << ": " << cold_matching.size()
+                << " and " << warm_matching.size() << std::endl;
+      return 1;
+    }
+    std::cout << seed << "\t"
+              << std::chrono::duration<double, std::milli>(middle - start).count() << "\t"
+              << std::chrono::duration<double, std::milli>(end - middle).count() << "\t"
+              << heuristic.size() << "\t" << cold_matching.size() << std::endl;
+  }
+  return 0;
+}
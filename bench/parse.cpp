@@ -0,0 +1,54 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+#include "smti.h"
+
+// Measures how fast instance files are read, by writing a random instance
+// to a temporary file and reading it back a number of times, with one
+// thread and with the given number of threads.
+int main(int argc, char *argv[]) {
+  if (argc < 4) {
+    std::cout << "Usage: bench_parse <size> <pref_length> <tie_density> [repeats] [threads]" << std::endl;
+    return 1;
+  }
+  int size = atoi(argv[1]);
+  int pref_length = atoi(argv[2]);
+  float tie_density = atof(argv[3]);
+  int repeats = (argc > 4) ? atoi(argv[4]) : 5;
+  int threads = (argc > 5) ? atoi(argv[5]) : 0;
+
+  std::mt19937 g(1);
+  SMTI instance(size, pref_length, tie_density, g);
+  std::filesystem::path filename = std::filesystem::temp_directory_path() / "bench_parse.instance";
+  {
+    std::ofstream out(filename);
+    out << instance.to_string();
+  }
+  double megabytes = std::filesystem::file_size(filename) / (1024.0 * 1024.0);
+
+  std::cout << "repeat\tMB\tms\tMB/s\tparallel_ms\tparallel_MB/s" << std::endl;
+  for(int repeat = 1; repeat <= repeats; ++repeat) {
+    auto start = std::chrono::steady_clock::now();
+    SMTI read(filename.string());
+    auto middle = std::chrono::steady_clock::now();
+    SMTI parallel_read(filename.string(), threads);
+    auto end = std::chrono::steady_clock::now();
+    if ((read.num_agents_left() != instance.num_agents_left()) ||
+        (parallel_read.num_agents_left() != instance.num_agents_left())) {
+      std::cerr << "Read " << read.num_agents_left() << " and " << parallel_read.num_agents_left()
+                << " agents, expected " << instance.num_agents_left() << std::endl;
+      return 1;
+    }
+    double ms = std::chrono::duration<double, std::milli>(middle - start).count();
+    double parallel_ms = std::chrono::duration<double, std::milli>(end - middle).count();
+    std::cout << repeat << "\t" << megabytes << "\t" << ms << "\t" << megabytes / (ms / 1000)
+              << "\t" << parallel_ms << "\t" << megabytes / (parallel_ms / 1000) << std::endl;
+  }
+  std::filesystem::remove(filename);
+  return 0;
+}
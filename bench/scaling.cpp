@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include "smti.h"
+
+// Sweeps a grid of instance parameters with several seeds per point, and
+// runs each selected route on each instance, printing one CSV line per run.
+// Every run happens in a forked child, so that a run that times out can be
+// stopped, and so that the peak RSS of each run is measured on its own. The
+// peak RSS includes generating the instance, which wall_ms does not.
+namespace {
+  struct Outcome {
+    double wall_ms = 0;
+    // For encodings, the variables and constraints in the header, and the
+    // length of the encoding. For the IP, the columns and rows of the model.
+    long variables = -1;
+    long constraints = -1;
+    long bytes = -1;
+    long solution = -1;
+  };
+
+  const std::vector<std::string> all_routes = {
+    "ip_merged", "ip_single", "sat_dummies", "wpmaxsat", "pbo", "pbo2", "pbo2_merged"};
+
+  std::vector<std::string> split(const std::string & list) {
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+      items.push_back(item);
+    }
+    return items;
+  }
+
+  // Read the numbers of variables and constraints from the first line of
+  // an encoding, which is either "p <format> V C" or
+  // "* #variable= V #constraint= C".
+  void read_header(const std::string & encoding, Outcome & outcome) {
+    std::stringstream header(encoding.substr(0, encoding.find('\n')));
+    std::string word;
+    std::vector<std::string> words;
+    while (header >> word) {
+      words.push_back(word);
+    }
+    if ((words.size() >= 4) && (words[0] == "p")) {
+      outcome.variables = std::stol(words[2]);
+      outcome.constraints = std::stol(words[3]);
+    } else if ((words.size() >= 5) && (words[1] == "#variable=")) {
+      outcome.variables = std::stol(words[2]);
+      outcome.constraints = std::stol(words[4]);
+    }
+    outcome.bytes = encoding.size();
+  }
+
+  Outcome run_route(const std::string & route, int size, int pref_length, float tie_density, int seed) {
+    SMTI instance(size, pref_length, tie_density, seed);
+    Outcome outcome;
+    auto start = std::chrono::steady_clock::now();
+    if ((route == "ip_merged") || (route == "ip_single")) {
+      SMTI::IP_Model model(&instance);
+      model.merge(route == "ip_merged");
+      outcome.solution = model.solve().size();
+      outcome.variables = model.num_cols();
+      outcome.constraints = model.num_rows();
+    } else if (route == "sat_dummies") {
+      // Ask whether there is a stable matching at least as large as one
+      // found by Gale-Shapley.
+      std::mt19937 g(seed);
+      outcome.solution = instance.gale_shapley(g).size();
+      instance.add_dummy(size - outcome.solution);
+      read_header(instance.encodeSAT(), outcome);
+    } else if (route == "wpmaxsat") {
+      read_header(instance.encodeWPMaxSAT(), outcome);
+    } else if (route == "pbo") {
+      read_header(instance.encodePBO(), outcome);
+    } else if (route == "pbo2") {
+      read_header(instance.encodePBO2(false), outcome);
+    } else if (route == "pbo2_merged") {
+      read_header(instance.encodePBO2(true), outcome);
+    }
+    outcome.wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return outcome;
+  }
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 4) {
+    std::cout << "Usage: bench_scaling <sizes> <pref_lengths> <tie_densities> [seeds] [timeout_s] [routes]" << std::endl;
+    std::cout << "sizes, pref_lengths, tie_densities and routes are comma-separated lists." << std::endl;
+    std::cout << "Routes are ip_merged, ip_single, sat_dummies, wpmaxsat, pbo, pbo2 and pbo2_merged, all by default." << std::endl;
+    return 1;
+  }
+  std::vector<std::string> sizes = split(argv[1]);
+  std::vector<std::string> pref_lengths = split(argv[2]);
+  std::vector<std::string> tie_densities = split(argv[3]);
+  int seeds = (argc > 4) ? atoi(argv[4]) : 5;
+  int timeout = (argc > 5) ? atoi(argv[5]) : 60;
+  std::vector<std::string> routes = (argc > 6) ? split(argv[6]) : all_routes;
+  for(const std::string & route: routes) {
+    if (std::find(all_routes.begin(), all_routes.end(), route) == all_routes.end()) {
+      std::cerr << "Unknown route " << route << std::endl;
+      return 1;
+    }
+  }
+
+  std::cout << "route,size,pref_length,tie_density,seed,status,wall_ms,peak_rss_kb,"
+            << "variables,constraints,bytes,solution_size" << std::endl;
+  for(const std::string & size: sizes) {
+    for(const std::string & pref_length: pref_lengths) {
+      for(const std::string & tie_density: tie_densities) {
+        for(int seed = 1; seed <= seeds; ++seed) {
+          for(const std::string & route: routes) {
+            int fds[2];
+            if (pipe(fds) != 0) {
+              perror("pipe");
+              return 1;
+            }
+            std::cout.flush();
+            pid_t child = fork();
+            if (child < 0) {
+              perror("fork");
+              return 1;
+            }
+            if (child == 0) {
+              close(fds[0]);
+              alarm(timeout);
+              Outcome outcome = run_route(route, std::stoi(size), std::stoi(pref_length),
+                                          std::stof(tie_density), seed);
+              if (write(fds[1], &outcome, sizeof(outcome)) != sizeof(outcome)) {
+                _exit(1);
+              }
+              _exit(0);
+            }
+            close(fds[1]);
+            Outcome outcome;
+            bool have_outcome = read(fds[0], &outcome, sizeof(outcome)) == sizeof(outcome);
+            close(fds[0]);
+            int status;
+            struct rusage usage;
+            wait4(child, &status, 0, &usage);
+            std::string result = "ok";
+            if (WIFSIGNALED(status) && (WTERMSIG(status) == SIGALRM)) {
+              result = "timeout";
+            } else if (!have_outcome || !WIFEXITED(status) || (WEXITSTATUS(status) != 0)) {
+              result = "error";
+            }
+            if (result != "ok") {
+              outcome = Outcome();
+              outcome.wall_ms = -1;
+            }
+            std::cout << route << "," << size << "," << pref_length << "," << tie_density << ","
+                      << seed << "," << result << "," << outcome.wall_ms << "," << usage.ru_maxrss
+                      << "," << outcome.variables << "," << outcome.constraints << ","
+                      << outcome.bytes << "," << outcome.solution << std::endl;
+          }
+        }
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "smti.h"
+
+// Runs every stage of the pipeline on a generated instance, and prints the
+// timings as JSON so that runs can be compared over time. Each benchmark
+// returns a number describing its output (a size or a count), which is
+// reported so that changes in behaviour are noticed as well as changes in
+// speed.
+namespace {
+  struct Benchmark {
+    std::string name;
+    // Called before each timed run, untimed, to give every run the same
+    // starting point.
+    std::function<void()> setup;
+    std::function<size_t()> run;
+  };
+
+  // Write a dense GRP score matrix in which each row has about pref_length
+  // scores at or above the returned threshold.
+  int write_grp(const std::filesystem::path & filename, int size, int pref_length, float tie_density, int seed) {
+    std::mt19937 g(seed);
+    // Fewer distinct scores give more ties.
+    int max_score = std::max(1, (int)(size * (1 - tie_density)));
+    std::uniform_int_distribution<int> score(0, max_score);
+    std::ofstream out(filename);
+    out << size << "\n" << size << "\n";
+    for(int row = 0; row < size; ++row) {
+      for(int col = 0; col < size; ++col) {
+        out << score(g) << ((col + 1 < size) ? " " : "\n");
+      }
+    }
+    return max_score - (int)((int64_t)max_score * pref_length / size);
+  }
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 4) {
+    std::cout << "Usage: bench_suite <size> <pref_length> <tie_density> [repeats] [seed] [benchmarks]" << std::endl;
+    std::cout << "benchmarks is a comma-separated list of names to run, all by default." << std::endl;
+    return 1;
+  }
+  int size = atoi(argv[1]);
+  int pref_length = atoi(argv[2]);
+  float tie_density = atof(argv[3]);
+  int repeats = (argc > 4) ? atoi(argv[4]) : 3;
+  int seed = (argc > 5) ? atoi(argv[5]) : 1;
+  std::vector<std::string> selected;
+  if (argc > 6) {
+    std::stringstream names(argv[6]);
+    std::string name;
+    while (std::getline(names, name, ',')) {
+      selected.push_back(name);
+    }
+  }
+
+  SMTI instance(size, pref_length, tie_density, seed);
+  std::filesystem::path directory = std::filesystem::temp_directory_path();
+  std::filesystem::path text = directory / "bench_suite.instance";
+  std::filesystem::path binary = directory / "bench_suite.bin";
+  std::filesystem::path grp = directory / "bench_suite.grp";
+  {
+    std::ofstream out(text);
+    out << instance.to_string();
+  }
+  instance.save_binary(binary.string());
+  int threshold = write_grp(grp, size, pref_length, tie_density, seed);
+
+  // The copy that each benchmark works on.
+  SMTI work(instance);
+  auto reset = [&work, &instance]() { work = SMTI(instance); };
+  auto nothing = []() { };
+  auto solve = [&work](bool merged) {
+    SMTI::IP_Model model(&work);
+    model.merge(merged);
+    return model.solve().size();
+  };
+
+  // The preferences left after preprocessing, as a check on the output
+  // that costs far less than what is being timed.
+  auto num_prefs = [&work]() {
+    size_t total = 0;
+    for(auto & [id, agent]: work.agents_left()) {
+      total += agent.num_prefs();
+    }
+    for(auto & [id, agent]: work.agents_right()) {
+      total += agent.num_prefs();
+    }
+    return total;
+  };
+
+  std::mt19937 generator(seed);
+  Matching stable = instance.gale_shapley(generator);
+
+  std::vector<Benchmark> benchmarks = {
+    {"parse", nothing, [&text]() { return (size_t)SMTI(text.string()).num_agents_left(); }},
+    {"parse_parallel", nothing, [&text]() { return (size_t)SMTI(text.string(), 0).num_agents_left(); }},
+    {"load_binary", nothing, [&binary]() { return (size_t)SMTI::load_binary(binary.string()).num_agents_left(); }},
+    {"create_from_GRP", nothing, [&grp, threshold]() {
+      return (size_t)SMTI::create_from_GRP(grp.string(), threshold).num_agents_left(); }},
+    {"preprocess_quick", reset, [&work, &num_prefs]() { work.preprocess(SMTI::Quick); return num_prefs(); }},
+    {"preprocess_complete", reset, [&work, &num_prefs]() { work.preprocess(SMTI::Complete); return num_prefs(); }},
+    {"encodeSAT", reset, [&work]() { return work.encodeSAT().size(); }},
+    {"encodeWPMaxSAT", reset, [&work]() { return work.encodeWPMaxSAT().size(); }},
+    {"encodePBO", reset, [&work]() { return work.encodePBO().size(); }},
+    {"encodePBO2", reset, [&work]() { return work.encodePBO2(false).size(); }},
+    {"encodePBO2_merged", reset, [&work]() { return work.encodePBO2(true).size(); }},
+    {"encodeMZN", reset, [&work]() { return work.encodeMZN(false).size(); }},
+    {"encodeMZN_optimise", reset, [&work]() { return work.encodeMZN(true).size(); }},
+    {"ip_solve", reset, [&solve]() { return solve(false); }},
+    {"ip_solve_merged", reset, [&solve]() { return solve(true); }},
+    {"components", nothing, [&work]() { return work.components().size(); }},
+    {"ip_solve_components", reset, [&work]() { return work.solve_components(0).size(); }},
+    {"check_stability", nothing, [&work, &stable]() { return work.check_stability(stable).blocking_pairs.size(); }},
+    {"find_all_stable_matchings", reset, [&work]() {
+      SMTI::IP_Model model(&work);
+      return model.find_all_stable_matchings().size(); }},
+  };
+
+  std::cout << "{" << std::endl;
+  std::cout << "  \"parameters\": {\"size\": " << size << ", \"pref_length\": " << pref_length
+            << ", \"tie_density\": " << tie_density << ", \"repeats\": " << repeats
+            << ", \"seed\": " << seed << "}," << std::endl;
+  std::cout << "  \"results\": [";
+  bool first = true;
+  for(const Benchmark & benchmark: benchmarks) {
+    if (!selected.empty() && (std::find(selected.begin(), selected.end(), benchmark.name) == selected.end())) {
+      continue;
+    }
+    std::vector<double> times;
+    size_t output = 0;
+    for(int repeat = 0; repeat < repeats; ++repeat) {
+      benchmark.setup();
+      auto start = std::chrono::steady_clock::now();
+      output = benchmark.run();
+      auto end = std::chrono::steady_clock::now();
+      times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    double mean = 0;
+    for(double time: times) {
+      mean += time / times.size();
+    }
+    std::cout << (first ? "" : ",") << std::endl;
+    first = false;
+    std::cout << "    {\"name\": \"" << benchmark.name << "\", \"output\": " << output
+              << ", \"min_ms\": " << times.front() << ", \"median_ms\": " << times[times.size() / 2]
+              << ", \"mean_ms\": " << mean << ", \"max_ms\": " << times.back() << "}";
+  }
+  std::cout << std::endl << "  ]" << std::endl << "}" << std::endl;
+
+  std::filesystem::remove(text);
+  std::filesystem::remove(binary);
+  std::filesystem::remove(grp);
+  return 0;
+}
@@ -76,6 +76,22 @@ Agent::Agent(int id, const std::vector<std::vector<int>> & preferences, bool is_
   }
 }
 
+Agent::Agent(int id, std::vector<std::vector<int>> && preferences, bool is_dummy) :
+  _id(id), _max_rank(0), _dummy_rank(is_dummy ? 0 : -1), _preferences(std::move(preferences)) {
+  size_t total = 0;
+  for(const std::vector<int> & group: _preferences) {
+    total += group.size();
+  }
+  _preferencesInOrder.reserve(total);
+  for(const std::vector<int> & group: _preferences) {
+    for(auto pref: group) {
+      _preferencesInOrder.push_back(pref);
+      _ranks[pref] = _max_rank;
+    }
+    _max_rank += 1;
+  }
+}
+
 bool Agent::is_compatible(const Agent & agent) const {
   return _ranks.find(agent.id()) != _ranks.end();
 }
@@ -251,3 +267,15 @@ std::string Agent::pref_list_string(std::string id_sep, std::string bracket_star
   }
   return ss.str();
 }
+
+size_t Agent::memory_usage() const {
+  size_t bytes = _preferences.capacity() * sizeof(std::vector<signed int>);
+  for(const std::vector<signed int> & tie: _preferences) {
+    bytes += tie.capacity() * sizeof(signed int);
+  }
+  bytes += _preferencesInOrder.capacity() * sizeof(signed int);
+  // Each node of a std::map holds a colour and three pointers as well as the
+  // entry.
+  bytes += _ranks.size() * (sizeof(std::pair<const int, int>) + 4 * sizeof(void*));
+  return bytes;
+}
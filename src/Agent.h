@@ -21,6 +21,12 @@ class Agent {
      */
     Agent(int id, const std::vector<std::vector<int>> & preferences, bool is_dummy = false);
 
+    /**
+     * As above, but takes over the given preferences instead of copying
+     * them.
+     */
+    Agent(int id, std::vector<std::vector<int>> && preferences, bool is_dummy = false);
+
     /**
      * Constructor using random number generator
      */
@@ -126,6 +132,12 @@ class Agent {
      */
     std::string pref_list_string(std::string id_sep = ":", std::string bracket_start = "[", std::string bracket_end = "]") const;
 
+    /**
+     * Bytes this agent holds on the heap for its preferences, estimated from
+     * the capacities of its containers. Does not include the Agent itself.
+     */
+    size_t memory_usage() const;
+
   private:
     int _id;
     unsigned int _max_rank;
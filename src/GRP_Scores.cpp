@@ -0,0 +1,272 @@
+#include <cmath>
+#include <cstring>
+
+#include "GRP_Scores.h"
+#include "MappedFile.h"
+#include "Scanner.h"
+#include "Stats.h"
+#include "smti.h"
+
+namespace {
+  // A key for a score such that higher scores have smaller keys, and equal
+  // scores (or, if quantum is positive, scores in the same multiple of
+  // quantum) have equal keys.
+  uint32_t score_key(float score, float quantum) {
+    uint32_t ascending;
+    if (quantum > 0) {
+      double bucket = std::floor(score / quantum);
+      bucket = std::max(bucket, (double)std::numeric_limits<int32_t>::min());
+      bucket = std::min(bucket, (double)std::numeric_limits<int32_t>::max());
+      ascending = (uint32_t)(int32_t)bucket ^ 0x80000000u;
+    } else {
+      if (score == 0) {
+        score = 0; // So that -0 and 0 tie.
+      }
+      uint32_t bits;
+      std::memcpy(&bits, &score, sizeof(bits));
+      // Flip negative numbers entirely, and the sign of positive ones, so
+      // that the order of the unsigned bits is the order of the floats.
+      ascending = (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+    }
+    return ~ascending;
+  }
+
+  // Stable sort of order by keys, as a radix sort on 16 bits at a time.
+  void radix_sort(std::vector<int> & order, const std::vector<uint32_t> & keys) {
+    std::vector<int> sorted(order.size());
+    for(int shift = 0; shift < 32; shift += 16) {
+      std::vector<size_t> start((1 << 16) + 1, 0);
+      for(int index: order) {
+        start[((keys[index] >> shift) & 0xffff) + 1]++;
+      }
+      for(size_t digit = 1; digit < start.size(); ++digit) {
+        start[digit] += start[digit - 1];
+      }
+      for(int index: order) {
+        sorted[start[(keys[index] >> shift) & 0xffff]++] = index;
+      }
+      order.swap(sorted);
+    }
+  }
+
+  // Read a line containing just a number.
+  int read_count(Scanner & scanner) {
+    scanner.skip_empty_lines();
+    scanner.skip_blanks();
+    int count = scanner.read_int();
+    scanner.next_line();
+    return count;
+  }
+} // namespace
+
+GRP_Scores::GRP_Scores(const std::string & filename, bool sparse, float quantum, float min_threshold) {
+  SMTI_TIME("grp_read");
+  MappedFile file(filename);
+  Scanner scanner(file.data(), file.data() + file.size());
+  _nrows = read_count(scanner);
+  _ncols = read_count(scanner);
+
+  // Only the pairs that pass the threshold are kept.
+  std::vector<int> rows;
+  std::vector<int> cols;
+  std::vector<float> scores;
+  if (sparse) {
+    for(;;) {
+      scanner.skip_empty_lines();
+      scanner.skip_blanks();
+      if (scanner.at_end()) {
+        break;
+      }
+      int row = scanner.read_int();
+      scanner.skip_blanks();
+      int col = scanner.read_int();
+      scanner.skip_blanks();
+      float score = scanner.read_float();
+      if ((row < 0) || (row >= _nrows) || (col < 0) || (col >= _ncols)) {
+        scanner.fail("pair out of range");
+      }
+      if (score >= min_threshold) {
+        rows.push_back(row);
+        cols.push_back(col);
+        scores.push_back(score);
+      }
+      scanner.next_line();
+    }
+  } else {
+    for(int row = 0; row < _nrows; ++row) {
+      int col = 0;
+      for(;;) {
+        scanner.skip_blanks();
+        if (scanner.at_line_end()) {
+          break;
+        }
+        if (col >= _ncols) {
+          scanner.fail("too many scores");
+        }
+        float score = scanner.read_float();
+        if (score >= min_threshold) {
+          rows.push_back(row);
+          cols.push_back(col);
+          scores.push_back(score);
+        }
+        col += 1;
+      }
+      scanner.next_line();
+    }
+  }
+  sort_pairs(rows, cols, scores, quantum);
+}
+
+void GRP_Scores::sort_pairs(const std::vector<int> & rows, const std::vector<int> & cols,
+                            const std::vector<float> & scores, float quantum) {
+  std::vector<uint32_t> exact(scores.size());
+  for(size_t index = 0; index < scores.size(); ++index) {
+    exact[index] = score_key(scores[index], 0);
+  }
+  std::vector<int> order(scores.size());
+  for(size_t index = 0; index < order.size(); ++index) {
+    order[index] = index;
+  }
+  radix_sort(order, exact);
+  std::vector<uint32_t> keys;
+  if (quantum > 0) {
+    // Sorting by the quantised score afterwards keeps the exact scores in
+    // order within each tie.
+    keys.resize(scores.size());
+    for(size_t index = 0; index < scores.size(); ++index) {
+      keys[index] = score_key(scores[index], quantum);
+    }
+    radix_sort(order, keys);
+  } else {
+    keys.swap(exact);
+  }
+
+  _row.resize(order.size());
+  _col.resize(order.size());
+  _key.resize(order.size());
+  _score.resize(order.size());
+  for(size_t pair = 0; pair < order.size(); ++pair) {
+    _row[pair] = rows[order[pair]];
+    _col[pair] = cols[order[pair]];
+    _key[pair] = keys[order[pair]];
+    _score[pair] = scores[order[pair]];
+  }
+
+  // Distributing the pairs, in order of score, to their row and column with
+  // a counting sort leaves each preference list sorted.
+  _start.assign(_nrows + _ncols + 1, 0);
+  for(size_t pair = 0; pair < _row.size(); ++pair) {
+    _start[_row[pair] + 1]++;
+    _start[_nrows + _col[pair] + 1]++;
+  }
+  for(int agent = 0; agent < _nrows + _ncols; ++agent) {
+    _start[agent + 1] += _start[agent];
+  }
+  _pairs.resize(2 * _row.size());
+  std::vector<int> fill(_start.begin(), _start.end() - 1);
+  for(size_t pair = 0; pair < _row.size(); ++pair) {
+    _pairs[fill[_row[pair]]++] = pair;
+    _pairs[fill[_nrows + _col[pair]]++] = pair;
+  }
+}
+
+SMTI GRP_Scores::instance(float threshold) const {
+  return build(threshold, std::vector<bool>(_nrows, false), std::vector<bool>(_ncols, false));
+}
+
+SMTI GRP_Scores::instance(float threshold, const Matching & removed) const {
+  std::vector<bool> row_matched(_nrows, false);
+  std::vector<bool> col_matched(_ncols, false);
+  for(auto [row, col]: removed) {
+    row_matched.at(row) = true;
+    col_matched.at(col) = true;
+  }
+  return build(threshold, row_matched, col_matched);
+}
+
+SMTI GRP_Scores::build(float threshold, const std::vector<bool> & row_matched,
+                       const std::vector<bool> & col_matched) const {
+  SMTI_TIME("grp_instance");
+  SMTI result;
+  result._size = 0;
+  result._ones.reserve(_nrows);
+  result._twos.reserve(_ncols);
+  for(int agent = 0; agent < _nrows + _ncols; ++agent) {
+    bool is_row = agent < _nrows;
+    int id = is_row ? agent : agent - _nrows;
+    if (is_row ? row_matched[id] : col_matched[id]) {
+      continue;
+    }
+    std::vector<std::vector<int>> preferences;
+    uint32_t last_key = 0;
+    for(int position = _start[agent]; position < _start[agent + 1]; ++position) {
+      int pair = _pairs[position];
+      if (_score[pair] < threshold) {
+        break;
+      }
+      int other = is_row ? _col[pair] : _row[pair];
+      if (is_row ? col_matched[other] : row_matched[other]) {
+        continue;
+      }
+      if (preferences.empty() || (_key[pair] != last_key)) {
+        preferences.emplace_back();
+        last_key = _key[pair];
+      }
+      preferences.back().push_back(other);
+    }
+    if (is_row) {
+      result._ones.emplace(id, Agent(id, std::move(preferences)));
+      result._size += 1;
+    } else {
+      result._twos.emplace(id, Agent(id, std::move(preferences)));
+    }
+  }
+  return result;
+}
+
+Matching GRP_Scores::forced_pairs(float threshold) const {
+  SMTI_TIME("grp_forced_pairs");
+  enum State : char { Free, Matched, Stuck };
+  std::vector<State> row_state(_nrows, Free);
+  std::vector<State> col_state(_ncols, Free);
+  // How many pairs in the current tie each agent has to agents that are not
+  // matched.
+  std::vector<int> row_count(_nrows, 0);
+  std::vector<int> col_count(_ncols, 0);
+  Matching forced;
+  size_t end = 0;
+  while ((end < _row.size()) && (_score[end] >= threshold)) {
+    size_t begin = end;
+    while ((end < _row.size()) && (_score[end] >= threshold) && (_key[end] == _key[begin])) {
+      end += 1;
+    }
+    for(size_t pair = begin; pair < end; ++pair) {
+      if ((row_state[_row[pair]] != Matched) && (col_state[_col[pair]] != Matched)) {
+        row_count[_row[pair]] += 1;
+        col_count[_col[pair]] += 1;
+      }
+    }
+    for(size_t pair = begin; pair < end; ++pair) {
+      int row = _row[pair];
+      int col = _col[pair];
+      if ((row_state[row] == Matched) || (col_state[col] == Matched)) {
+        continue;
+      }
+      // Each agent is the other's only best choice left.
+      if ((row_state[row] == Free) && (col_state[col] == Free) &&
+          (row_count[row] == 1) && (col_count[col] == 1)) {
+        row_state[row] = Matched;
+        col_state[col] = Matched;
+        forced.emplace_back(row, col);
+      } else {
+        row_state[row] = Stuck;
+        col_state[col] = Stuck;
+      }
+    }
+    for(size_t pair = begin; pair < end; ++pair) {
+      row_count[_row[pair]] = 0;
+      col_count[_col[pair]] = 0;
+    }
+  }
+  return forced;
+}
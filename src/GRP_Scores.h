@@ -0,0 +1,88 @@
+#ifndef GRP_SCORES_H
+#define GRP_SCORES_H
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "matching.h"
+
+class SMTI;
+
+/**
+ * The scores of a Globally Ranked Pairs instance, read and sorted once, from
+ * which the SMTI instance for any threshold can be built. Rows are agents on
+ * the left and columns are agents on the right, and higher scores are
+ * better for both.
+ */
+class GRP_Scores {
+  public:
+    /**
+     * Read scores from a file, either a dense matrix as for
+     * SMTI::create_from_GRP() or one pair per line as for
+     * SMTI::create_from_sparse_GRP(). Scores below min_threshold are
+     * dropped straight away, so no instance with a lower threshold can be
+     * built. If quantum is positive, scores in the same multiple of quantum
+     * are tied. Throws std::invalid_argument if the file is malformed.
+     */
+    GRP_Scores(const std::string & filename, bool sparse = false, float quantum = 0,
+               float min_threshold = std::numeric_limits<float>::lowest());
+
+    /**
+     * The instance in which a pair is acceptable if and only if its score is
+     * at least threshold. Takes time linear in the size of the instance.
+     */
+    SMTI instance(float threshold) const;
+
+    /**
+     * As instance(), but without the agents in any pair of removed.
+     */
+    SMTI instance(float threshold, const Matching & removed) const;
+
+    /**
+     * The pairs that are in every stable matching of instance(threshold).
+     * Going through the pairs from the highest score down, a pair is forced
+     * if neither of its agents is matched yet, and neither has any other
+     * pair with the same score to an agent that is still unmatched. Any pair
+     * that is not forced leaves its agents without a forced partner for
+     * good. If no two pairs that share an agent are tied, every pair is
+     * decided this way, and the result is the only stable matching. Takes
+     * time linear in the number of pairs above the threshold.
+     */
+    Matching forced_pairs(float threshold) const;
+
+    int num_rows() const { return _nrows; }
+    int num_cols() const { return _ncols; }
+
+    /**
+     * The number of pairs kept from the file.
+     */
+    size_t num_pairs() const { return _row.size(); }
+
+  private:
+    // Sort the pairs read from the file into the preference lists.
+    void sort_pairs(const std::vector<int> & rows, const std::vector<int> & cols,
+                    const std::vector<float> & scores, float quantum);
+
+    // Build an instance from the agents that are not matched.
+    SMTI build(float threshold, const std::vector<bool> & row_matched,
+               const std::vector<bool> & col_matched) const;
+
+    int _nrows;
+    int _ncols;
+    // All pairs, best first. Pairs in the same tie have the same key, and
+    // scores are in decreasing order even within a tie, so the pairs above
+    // a threshold are always a prefix, as are those of each agent.
+    std::vector<int> _row;
+    std::vector<int> _col;
+    std::vector<uint32_t> _key;
+    std::vector<float> _score;
+    // The pairs of row r are at positions _start[r] up to _start[r+1] of
+    // _pairs, and of column c at _start[_nrows + c] up to
+    // _start[_nrows + c + 1], best first.
+    std::vector<int> _start;
+    std::vector<int> _pairs;
+};
+
+#endif /* GRP_SCORES_H */
@@ -1,24 +1,38 @@
+#include <algorithm>
 #include <iostream>
 #include "Graph.h"
+#include "Stats.h"
 
 
-// Expected biggest graph, to save on allocations
-const size_t expected_size = 4096;
-
-Graph::Graph() : _exists(2), _adjacents(2), _matching(2), _size(0), _matching_size(0) {
-  _exists[0] = std::vector<bool>(expected_size, false);
-  _exists[1] = std::vector<bool>(expected_size, false);
-  _adjacents[0] = std::vector<std::vector<int>>(expected_size);
-  _adjacents[1] = std::vector<std::vector<int>>(expected_size);
-  _matching[0] = std::vector<signed int>(expected_size, -1);
-  _matching[1] = std::vector<signed int>(expected_size, -1);
+Graph::Graph(int left_size, int right_size) : _exists(2), _adjacents(2), _matching(2), _vertices(2),
+                                               _visited(left_size, 0), _search(0), _size(0), _matching_size(0) {
+  _exists[0] = std::vector<bool>(left_size, false);
+  _exists[1] = std::vector<bool>(right_size, false);
+  _adjacents[0] = std::vector<std::vector<int>>(left_size);
+  _adjacents[1] = std::vector<std::vector<int>>(right_size);
+  _matching[0] = std::vector<signed int>(left_size, -1);
+  _matching[1] = std::vector<signed int>(right_size, -1);
 #ifdef DEBUG
   std::cout << "New graph" << std::endl; 
 #endif /* DEBUG */
 }
 
+void Graph::clear() {
+  for(int side = 0; side < 2; ++side) {
+    for(int name: _vertices[side]) {
+      _exists[side][name] = false;
+      _adjacents[side][name].clear();
+      _matching[side][name] = -1;
+    }
+    _vertices[side].clear();
+  }
+  _size = 0;
+  _matching_size = 0;
+}
+
 void Graph::addVertex(int side, int name) {
 	_exists[side][name] = true;
+	_vertices[side].push_back(name);
 	_size += 1;
 }
 
@@ -47,24 +61,28 @@ int Graph::matchingSize() const {
  * Augment the matching, starting at vertex name which is on the right.
  */
 void Graph::augment(int name) {
+  SMTI_COUNT("augment", 1);
 #ifdef DEBUG
   std::cout << "Augmenting on " << _indices.at(start) << std::endl;
   this->printGraph();
 #endif /* DEBUG */
   std::list<int> path;
-  std::vector<bool> visited(expected_size, false);
   path.push_back(name);
-  internal_augment(name, visited, path);
+  if (++_search == 0) {
+    // Wrapped around, so forget old searches properly.
+    std::fill(_visited.begin(), _visited.end(), 0);
+    _search = 1;
+  }
+  internal_augment(name, path);
 }
 
 /**
  * Continues an augmentation, on vertex now, which is on the right.
  */
-bool Graph::internal_augment(int now, std::vector<bool> & visited,
-    std::list<int> & path) {
+bool Graph::internal_augment(int now, std::list<int> & path) {
   for(int next: _adjacents[1][now]) {
     // next is on the left
-    if (visited[next]) {
+    if (_visited[next] == _search) {
       continue;
     }
     if (_matching[0][next] == -1) {
@@ -95,8 +113,8 @@ bool Graph::internal_augment(int now, std::vector<bool> & visited,
     int next2 = _matching[0][next];
     path.push_back(next);
     path.push_back(next2);
-    visited[next] = true;
-    if (internal_augment(next2, visited, path)) {
+    _visited[next] = _search;
+    if (internal_augment(next2, path)) {
       return true;
     }
     path.pop_back();
@@ -27,9 +27,16 @@ inline std::ostream& operator<<(std::ostream& o, const std::pair<int, int> &x) {
 #endif /* DEBUG */
 
 
+/**
+ * A bipartite graph for finding augmenting paths, on vertices named
+ * 0..left_size-1 on the left (side 0) and 0..right_size-1 on the right
+ * (side 1). clear() empties it in time proportional to what was added, so
+ * one graph can be reused for many small searches.
+ */
 class Graph {
   public:
-    Graph();
+    Graph(int left_size, int right_size);
+    void clear();
     void addVertex(int side, int name);
     bool containsVertex(int side, int name) const;
     void addEdge(int v1, int v2);
@@ -50,11 +57,17 @@ class Graph {
     std::vector<std::vector<bool>> _exists;
     std::vector<std::vector<std::vector<int>>> _adjacents;
     std::vector<std::vector<signed int>> _matching;
+    // The vertices added to each side since the last clear().
+    std::vector<std::vector<int>> _vertices;
+    // A left vertex has been visited in the current augment() if its entry is
+    // _search, so that nothing needs resetting between searches.
+    std::vector<unsigned int> _visited;
+    unsigned int _search;
 
     int _size;
     int _matching_size;
 
-    bool internal_augment(int now, std::vector<bool> & visited, std::list<int> & path);
+    bool internal_augment(int now, std::list<int> & path);
 };
 
 #endif /* GRAPH_H */
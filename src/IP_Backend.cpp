@@ -0,0 +1,301 @@
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+#include <CoinFinite.hpp>
+#include <CoinPackedMatrix.hpp>
+#include <CoinPackedVector.hpp>
+#include <OsiSymSolverInterface.hpp>
+#include <OsiSymSolverParameters.hpp>
+#ifdef HAVE_OSI_CBC
+#include <CbcEventHandler.hpp>
+#include <CbcModel.hpp>
+#include <OsiCbcSolverInterface.hpp>
+#endif
+#ifdef HAVE_OSI_CLP
+#include <ClpSimplex.hpp>
+#include <OsiClpSolverInterface.hpp>
+#endif
+
+#include "IP_Backend.h"
+
+namespace {
+
+constexpr double tolerance = 1e-6;
+
+class GenericBackend : public IP_Backend {
+  public:
+    GenericBackend(const std::string & name, std::unique_ptr<OsiSolverInterface> solver) :
+      IP_Backend(name, std::move(solver)) { }
+};
+
+class SymphonyBackend : public IP_Backend {
+  public:
+    SymphonyBackend() : IP_Backend("symphony", std::make_unique<OsiSymSolverInterface>()) { }
+
+    void set_options(const IP_Options & options) override {
+      IP_Backend::set_options(options);
+      sym().setSymParam(OsiSymVerbosity, options.verbose ? 0 : -2);
+      if (options.time_limit >= 0) {
+        sym().setSymParam(OsiSymTimeLimit, options.time_limit);
+      }
+      if (options.gap_limit >= 0) {
+        // Symphony takes the gap as a percentage.
+        sym().setSymParam(OsiSymGapLimit, 100 * options.gap_limit);
+      }
+      _node_limit = options.node_limit;
+    }
+
+    void set_cutoff(double objective, double granularity) override {
+      sym().setSymParam(OsiSymUpperBound, objective);
+      sym().setSymParam(OsiSymGranularity, granularity);
+    }
+
+    // Symphony's initialSolve() already does branch and bound, and solves
+    // the relaxation if no columns are integer. To report progress, the
+    // search is run a number of nodes at a time, and resumed from Symphony's
+    // warm start until it finishes or monitor asks it to stop.
+    void solve_mip(const Monitor & monitor) override {
+      sym().setSymParam(OsiSymKeepWarmStart, 1);
+      int limit = next_node_limit(0);
+      sym().setSymParam(OsiSymNodeLimit, limit);
+      _solver->initialSolve();
+      while (sym().isIterationLimitReached() && (limit != _node_limit)) {
+        IP_Progress now;
+        progress(now);
+        if (monitor && !monitor(now)) {
+          return;
+        }
+        limit = next_node_limit(limit);
+        sym().setSymParam(OsiSymNodeLimit, limit);
+        _solver->resolve();
+      }
+    }
+
+    bool limit_reached() const override {
+      return sym().isIterationLimitReached() || sym().isTimeLimitReached() ||
+             sym().isTargetGapReached();
+    }
+
+    int nodes() const override { return _solver->getIterationCount(); }
+
+  private:
+    OsiSymSolverInterface & sym() { return static_cast<OsiSymSolverInterface &>(*_solver); }
+    const OsiSymSolverInterface & sym() const { return static_cast<const OsiSymSolverInterface &>(*_solver); }
+
+    int next_node_limit(int current) const {
+      int next = current + nodes_per_report;
+      if ((_node_limit >= 0) && (next > _node_limit)) {
+        return _node_limit;
+      }
+      return next;
+    }
+
+    // How many nodes to process between calls to monitor.
+    static constexpr int nodes_per_report = 1000;
+
+    int _node_limit = -1;
+};
+
+#ifdef HAVE_OSI_CBC
+// Passes Cbc's progress to a monitor, and stops Cbc when asked to.
+class CbcMonitor : public CbcEventHandler {
+  public:
+    explicit CbcMonitor(const IP_Backend::Monitor & monitor) : _monitor(monitor) { }
+
+    CbcEventHandler * clone() const override { return new CbcMonitor(*this); }
+
+    CbcAction event(CbcEvent which) override {
+      if ((which != node) && (which != solution) && (which != heuristicSolution)) {
+        return noAction;
+      }
+      // Checking on every node would slow Cbc down.
+      if ((which == node) && (++_calls % nodes_per_report != 0)) {
+        return noAction;
+      }
+      IP_Progress now;
+      now.nodes = model_->getNodeCount();
+      now.incumbent = (model_->bestSolution() != nullptr) ? model_->getObjValue() : -COIN_DBL_MAX;
+      now.bound = model_->getBestPossibleObjValue();
+      return _monitor(now) ? noAction : stop;
+    }
+
+  private:
+    static constexpr int nodes_per_report = 1000;
+
+    IP_Backend::Monitor _monitor;
+    int _calls = 0;
+};
+
+class CbcBackend : public IP_Backend {
+  public:
+    CbcBackend() : IP_Backend("cbc", std::make_unique<OsiCbcSolverInterface>()) { }
+
+    void set_options(const IP_Options & options) override {
+      IP_Backend::set_options(options);
+      CbcModel * model = cbc().getModelPtr();
+      model->setLogLevel(options.verbose ? 1 : 0);
+      if (options.threads >= 0) {
+        model->setNumberThreads(options.threads);
+      }
+      if (options.time_limit >= 0) {
+        model->setMaximumSeconds(options.time_limit);
+      }
+      if (options.gap_limit >= 0) {
+        model->setAllowableFractionGap(options.gap_limit);
+      }
+      if (options.node_limit >= 0) {
+        model->setMaximumNodes(options.node_limit);
+      }
+    }
+
+    void solve_mip(const Monitor & monitor) override {
+      if (monitor) {
+        CbcMonitor handler(monitor);
+        cbc().getModelPtr()->passInEventHandler(&handler);
+      }
+      _solver->branchAndBound();
+    }
+
+    bool limit_reached() const override {
+      CbcModel * model = cbc().getModelPtr();
+      return model->isSecondsLimitReached() || model->isNodeLimitReached() ||
+             _solver->isIterationLimitReached();
+    }
+
+    double best_bound() const override {
+      return cbc().getModelPtr()->getBestPossibleObjValue();
+    }
+
+    int nodes() const override { return cbc().getModelPtr()->getNodeCount(); }
+
+  private:
+    OsiCbcSolverInterface & cbc() { return static_cast<OsiCbcSolverInterface &>(*_solver); }
+    const OsiCbcSolverInterface & cbc() const { return static_cast<const OsiCbcSolverInterface &>(*_solver); }
+};
+#endif /* HAVE_OSI_CBC */
+
+#ifdef HAVE_OSI_CLP
+class ClpBackend : public IP_Backend {
+  public:
+    ClpBackend() : IP_Backend("clp", std::make_unique<OsiClpSolverInterface>()) { }
+
+    void set_options(const IP_Options & options) override {
+      IP_Backend::set_options(options);
+      if (options.time_limit >= 0) {
+        clp().getModelPtr()->setMaximumSeconds(options.time_limit);
+      }
+    }
+
+  private:
+    OsiClpSolverInterface & clp() { return static_cast<OsiClpSolverInterface &>(*_solver); }
+};
+#endif /* HAVE_OSI_CLP */
+
+std::mutex registry_mutex;
+
+std::map<std::string, IP_Backend::Factory> & registry() {
+  static std::map<std::string, IP_Backend::Factory> backends = {
+    {"symphony", []() { return std::unique_ptr<IP_Backend>(new SymphonyBackend()); }},
+#ifdef HAVE_OSI_CBC
+    {"cbc", []() { return std::unique_ptr<IP_Backend>(new CbcBackend()); }},
+#endif
+#ifdef HAVE_OSI_CLP
+    {"clp", []() { return std::unique_ptr<IP_Backend>(new ClpBackend()); }},
+#endif
+  };
+  return backends;
+}
+
+} // namespace
+
+std::unique_ptr<IP_Backend> IP_Backend::create(const std::string & name) {
+  Factory factory;
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    auto found = registry().find(name);
+    if (found == registry().end()) {
+      throw std::invalid_argument("No IP backend called " + name);
+    }
+    factory = found->second;
+  }
+  return factory();
+}
+
+void IP_Backend::register_backend(const std::string & name, Factory factory) {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  registry()[name] = std::move(factory);
+}
+
+std::vector<std::string> IP_Backend::available() {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  std::vector<std::string> names;
+  for(auto & [name, factory]: registry()) {
+    names.push_back(name);
+  }
+  return names;
+}
+
+std::unique_ptr<IP_Backend> IP_Backend::wrap(const std::string & name,
+                                             std::unique_ptr<OsiSolverInterface> solver) {
+  return std::unique_ptr<IP_Backend>(new GenericBackend(name, std::move(solver)));
+}
+
+void IP_Backend::set_options(const IP_Options & options) {
+  _solver->messageHandler()->setLogLevel(options.verbose ? 1 : 0);
+  _solver->setHintParam(OsiDoReducePrint, !options.verbose, OsiHintTry);
+}
+
+void IP_Backend::set_cutoff(double objective, double granularity) {
+  const double * obj = _solver->getObjCoefficients();
+  CoinPackedVector row;
+  for(int i = 0; i < _solver->getNumCols(); ++i) {
+    if (obj[i] != 0) {
+      row.insert(i, obj[i]);
+    }
+  }
+  _solver->addRow(row, objective + granularity, _solver->getInfinity());
+}
+
+double IP_Backend::best_bound() const {
+  if (_solver->isProvenOptimal()) {
+    return _solver->getObjValue();
+  }
+  return COIN_DBL_MAX;
+}
+
+bool IP_Backend::has_solution() const {
+  int num_cols = _solver->getNumCols();
+  const double * x = _solver->getColSolution();
+  if (x == nullptr) {
+    return false;
+  }
+  const double * col_lb = _solver->getColLower();
+  const double * col_ub = _solver->getColUpper();
+  for(int i = 0; i < num_cols; ++i) {
+    if ((x[i] < col_lb[i] - tolerance) || (x[i] > col_ub[i] + tolerance)) {
+      return false;
+    }
+    if (_solver->isInteger(i) && (std::fabs(x[i] - std::round(x[i])) > tolerance)) {
+      return false;
+    }
+  }
+  const CoinPackedMatrix * rows = _solver->getMatrixByRow();
+  std::vector<double> activity(_solver->getNumRows());
+  rows->times(x, activity.data());
+  const double * row_lb = _solver->getRowLower();
+  const double * row_ub = _solver->getRowUpper();
+  for(int row = 0; row < _solver->getNumRows(); ++row) {
+    if ((activity[row] < row_lb[row] - tolerance) || (activity[row] > row_ub[row] + tolerance)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void IP_Backend::progress(IP_Progress & progress) const {
+  progress.incumbent = has_solution() ? _solver->getObjValue() : -COIN_DBL_MAX;
+  progress.bound = best_bound();
+  progress.nodes = nodes();
+}
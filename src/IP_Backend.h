@@ -0,0 +1,181 @@
+#ifndef IP_BACKEND_H
+#define IP_BACKEND_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <CoinFinite.hpp>
+#include <OsiSolverInterface.hpp>
+
+/**
+ * Solver settings that every backend understands. Negative values leave the
+ * solver's own default in place. Backends ignore settings they have no way
+ * of applying (e.g., Symphony cannot change its number of threads at
+ * runtime).
+ */
+struct IP_Options {
+  // Number of threads the solver may use.
+  int threads = -1;
+  // Wall-clock time limit in seconds.
+  double time_limit = -1;
+  // Relative gap between incumbent and bound at which to stop, e.g. 0.01 for
+  // 1%.
+  double gap_limit = -1;
+  // Maximum number of branch and bound nodes.
+  int node_limit = -1;
+  // Print solver output.
+  bool verbose = false;
+};
+
+/**
+ * A snapshot of the progress of a solve. Values that the solver does not
+ * report are left at their defaults.
+ */
+struct IP_Progress {
+  // Objective value of the best solution found, or -COIN_DBL_MAX if none.
+  double incumbent = -COIN_DBL_MAX;
+  // Best known bound on the objective value.
+  double bound = COIN_DBL_MAX;
+  // Number of branch and bound nodes processed.
+  int nodes = 0;
+  // Wall-clock seconds since the solve started.
+  double seconds = 0;
+};
+
+/**
+ * A flag that may be set from any thread to ask a running solve to stop.
+ * Copies share the same flag.
+ */
+class CancelToken {
+  public:
+    CancelToken() : _flag(std::make_shared<std::atomic<bool>>(false)) { }
+    void cancel() { _flag->store(true); }
+    bool cancelled() const { return _flag->load(); }
+    void reset() { _flag->store(false); }
+  private:
+    std::shared_ptr<std::atomic<bool>> _flag;
+};
+
+/**
+ * Wraps an OsiSolverInterface, along with the knowledge of how to set the
+ * options above for that solver. Backends are created by name, so the
+ * solver used by IP_Model can be chosen at runtime.
+ *
+ * The backends "symphony" (always), "cbc" and "clp" (if found when
+ * building) are registered by default. Any other Osi solver can be added
+ * with register_backend(), e.g.
+ *
+ *   IP_Backend::register_backend("gurobi", []() {
+ *     return IP_Backend::wrap("gurobi", std::make_unique<OsiGrbSolverInterface>());
+ *   });
+ */
+class IP_Backend {
+  public:
+    typedef std::function<std::unique_ptr<IP_Backend>()> Factory;
+
+    /**
+     * Called by a backend during a solve, where the solver allows it. The
+     * solve stops early if this returns false.
+     */
+    typedef std::function<bool(IP_Progress &)> Monitor;
+
+    virtual ~IP_Backend() = default;
+
+    /**
+     * Create a new backend of the given name. Throws std::invalid_argument
+     * if no such backend is registered.
+     */
+    static std::unique_ptr<IP_Backend> create(const std::string & name);
+
+    /**
+     * Make a backend available to create(), replacing any existing backend
+     * of the same name.
+     */
+    static void register_backend(const std::string & name, Factory factory);
+
+    /**
+     * The names of all registered backends.
+     */
+    static std::vector<std::string> available();
+
+    /**
+     * Wrap any Osi solver as a backend. Only the options that can be set
+     * through the generic Osi interface are applied.
+     */
+    static std::unique_ptr<IP_Backend> wrap(const std::string & name,
+                                            std::unique_ptr<OsiSolverInterface> solver);
+
+    /**
+     * The name this backend was created with.
+     */
+    const std::string & name() const { return _name; }
+
+    /**
+     * The underlying solver.
+     */
+    OsiSolverInterface & solver() { return *_solver; }
+    const OsiSolverInterface & solver() const { return *_solver; }
+
+    /**
+     * Apply the given options to the solver. Call after loading a problem.
+     */
+    virtual void set_options(const IP_Options & options);
+
+    /**
+     * Only look for solutions with objective (which must be maximised) at
+     * least objective + granularity. By default, this is done by adding the
+     * objective as a row to the problem.
+     */
+    virtual void set_cutoff(double objective, double granularity);
+
+    /**
+     * Solve the loaded problem, respecting integrality. Backends that cannot
+     * interrupt their solver never call monitor.
+     */
+    virtual void solve_mip(const Monitor & monitor) { _solver->branchAndBound(); }
+
+    /**
+     * Did the solver stop because of a time, node or gap limit?
+     */
+    virtual bool limit_reached() const { return _solver->isIterationLimitReached(); }
+
+    /**
+     * The best bound on the objective value proven by the solver, or
+     * COIN_DBL_MAX if the solver does not report one.
+     */
+    virtual double best_bound() const;
+
+    /**
+     * The number of branch and bound nodes processed, if known.
+     */
+    virtual int nodes() const { return 0; }
+
+    /**
+     * Does the solver hold an integer solution that satisfies every bound
+     * and row of the loaded problem? Solvers differ in what getColSolution()
+     * returns when stopped early, so this is checked directly.
+     */
+    bool has_solution() const;
+
+    /**
+     * Solve the LP relaxation of the loaded problem. Note that some solvers
+     * (e.g., Symphony) ignore this distinction, so integrality should not be
+     * set on columns first.
+     */
+    virtual void solve_lp() { _solver->initialSolve(); }
+
+  protected:
+    // Fill in a progress report from the solver's current state.
+    void progress(IP_Progress & progress) const;
+
+    IP_Backend(const std::string & name, std::unique_ptr<OsiSolverInterface> solver) :
+      _name(name), _solver(std::move(solver)) { }
+
+    std::string _name;
+    std::unique_ptr<OsiSolverInterface> _solver;
+};
+
+#endif /* IP_BACKEND_H */
@@ -0,0 +1,59 @@
+#ifndef ID_MAP_H
+#define ID_MAP_H
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Maps external identifiers, such as strings or sparse 64-bit numbers, to
+ * dense IDs first, first+1, ... in order of first use, and back again. The
+ * library works on the dense IDs, so arrays can be indexed by them, while
+ * input and output use the external identifiers.
+ */
+template <typename Key, typename Hash = std::hash<Key>>
+class IdMap {
+  public:
+    /**
+     * param first The dense ID of the first key, which must not be
+     * negative.
+     */
+    explicit IdMap(int first = 0) : _first(first) { }
+
+    /**
+     * The dense ID of key, giving it the next one if it has none yet.
+     */
+    int add(const Key & key) {
+      auto [entry, inserted] = _ids.try_emplace(key, _first + int(_keys.size()));
+      if (inserted) {
+        _keys.push_back(key);
+      }
+      return entry->second;
+    }
+
+    /**
+     * The dense ID of key, or -1 if it has none.
+     */
+    int find(const Key & key) const {
+      auto entry = _ids.find(key);
+      return (entry == _ids.end()) ? -1 : entry->second;
+    }
+
+    bool contains(const Key & key) const { return _ids.count(key) > 0; }
+
+    /**
+     * The key with the given dense ID. Throws std::out_of_range if there is
+     * no such key.
+     */
+    const Key & key(int id) const { return _keys.at(id - _first); }
+
+    int first() const { return _first; }
+    int size() const { return _keys.size(); }
+
+  private:
+    int _first;
+    std::vector<Key> _keys;
+    std::unordered_map<Key, int, Hash> _ids;
+};
+
+#endif /* ID_MAP_H */
@@ -0,0 +1,335 @@
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+#include <unordered_set>
+
+#include "InstanceGenerator.h"
+#include "InstanceView.h"
+#include "SplitMix64.h"
+
+namespace {
+  // Sample count distinct values from 1 to size, in random order, with
+  // Floyd's algorithm, so the time depends on count and not on size.
+  std::vector<int> sample(int size, int count, SplitMix64 & generator) {
+    std::vector<int> chosen;
+    chosen.reserve(count);
+    // Short lists are searched directly, which is faster than hashing.
+    const int max_linear = 32;
+    std::unordered_set<int> seen;
+    if (count > max_linear) {
+      seen.reserve(count);
+    }
+    for(int top = size - count + 1; top <= size; ++top) {
+      int value = 1 + generator.uniform(top);
+      bool taken = (count > max_linear) ? (seen.count(value) > 0) :
+          (std::find(chosen.begin(), chosen.end(), value) != chosen.end());
+      if (taken) {
+        value = top;
+      }
+      chosen.push_back(value);
+      if (count > max_linear) {
+        seen.insert(value);
+      }
+    }
+    // Floyd's algorithm picks a uniform set, but not in a uniform order.
+    for(int i = count - 1; i > 0; --i) {
+      std::swap(chosen[i], chosen[generator.uniform(i + 1)]);
+    }
+    return chosen;
+  }
+
+  // Split a list in order into tie groups, where each agent after the first
+  // is tied with the one before with probability tie_density.
+  std::vector<std::vector<int>> make_ties(const std::vector<int> & order, float tie_density,
+                                          SplitMix64 & generator) {
+    std::vector<std::vector<int>> preferences;
+    for(int id: order) {
+      if (preferences.empty() || (generator.uniform_real() >= tie_density)) {
+        preferences.emplace_back();
+      }
+      preferences.back().push_back(id);
+    }
+    return preferences;
+  }
+
+  // Writes 8-byte aligned sections to a file, keeping the checksum of
+  // everything written.
+  class SectionWriter {
+    public:
+      SectionWriter(std::ofstream & out) : _out(out), _hash(BinaryInstanceHeader::compute_checksum(nullptr, 0)) { }
+
+      template <typename T>
+      void write(T value) {
+        const char * bytes = reinterpret_cast<const char *>(&value);
+        _buffer.insert(_buffer.end(), bytes, bytes + sizeof(T));
+        if (_buffer.size() >= (1 << 20)) {
+          flush(false);
+        }
+      }
+
+      // Pad the current section to a multiple of 8 bytes.
+      void end_section() {
+        _buffer.resize((_buffer.size() + 7) / 8 * 8, 0);
+        flush(true);
+      }
+
+      uint64_t checksum() const { return _hash; }
+
+    private:
+      void flush(bool all) {
+        size_t length = all ? _buffer.size() : _buffer.size() / 8 * 8;
+        _hash = BinaryInstanceHeader::continue_checksum(_hash, _buffer.data(), length);
+        _out.write(_buffer.data(), length);
+        _buffer.erase(_buffer.begin(), _buffer.begin() + length);
+      }
+
+      std::ofstream & _out;
+      uint64_t _hash;
+      std::vector<char> _buffer;
+  };
+} // namespace
+
+InstanceGenerator::InstanceGenerator(int size, int pref_length, float tie_density, uint64_t seed) :
+  _size(size), _pref_length(std::min(pref_length, size)), _seed(seed) {
+  _shape.tie_density = tie_density;
+}
+
+InstanceGenerator::InstanceGenerator(int size, int pref_length, const Shape & shape, uint64_t seed) :
+  _size(size), _pref_length(std::min(pref_length, size)), _shape(shape), _seed(seed) { }
+
+// Agent i on the left uses stream 2i, and agent j on the right stream 2j + 1.
+std::vector<std::vector<int>> InstanceGenerator::left(int id) const {
+  SplitMix64 generator(_seed, 2 * (uint64_t)id);
+  if (_shape.family == Uniform) {
+    return make_ties(sample(_size, _pref_length, generator), _shape.tie_density, generator);
+  }
+  return rank(true, id, choose(generator));
+}
+
+std::vector<std::vector<int>> InstanceGenerator::right(int id, std::vector<int> choosers) const {
+  if (_shape.family != Uniform) {
+    return rank(false, id, choosers);
+  }
+  SplitMix64 generator(_seed, 2 * (uint64_t)id + 1);
+  for(int k = (int)choosers.size() - 1; k > 0; --k) {
+    std::swap(choosers[k], choosers[generator.uniform(k + 1)]);
+  }
+  return make_ties(choosers, _shape.tie_density, generator);
+}
+
+std::vector<int> InstanceGenerator::choose(SplitMix64 & generator) const {
+  if (_shape.family != Popularity) {
+    return sample(_size, _pref_length, generator);
+  }
+  // Draw from a continuous power law on [1, size + 1) by inverting its
+  // distribution function, so that nothing depends on size. A partner
+  // already chosen is replaced by the next ID up that is not.
+  std::vector<int> chosen;
+  chosen.reserve(_pref_length);
+  std::unordered_set<int> seen;
+  seen.reserve(_pref_length);
+  double exponent = 1 - _shape.skew;
+  double top = _size + 1;
+  while ((int)chosen.size() < _pref_length) {
+    double u = generator.uniform_real();
+    double x;
+    if (std::abs(exponent) < 1e-9) {
+      x = std::pow(top, u);
+    } else {
+      x = std::pow(1 + u * (std::pow(top, exponent) - 1), 1 / exponent);
+    }
+    int value = std::min<int>(_size, std::max<int>(1, (int)x));
+    while (seen.count(value) > 0) {
+      value = (value % _size) + 1;
+    }
+    seen.insert(value);
+    chosen.push_back(value);
+  }
+  return chosen;
+}
+
+std::vector<std::vector<int>> InstanceGenerator::rank(bool is_left, int id, const std::vector<int> & partners) const {
+  std::vector<std::pair<float, int>> scored;
+  scored.reserve(partners.size());
+  for(int partner: partners) {
+    scored.emplace_back(score(is_left, id, partner), partner);
+  }
+  // Best first, with equal scores in order of ID.
+  std::sort(scored.begin(), scored.end(), [](const auto & lhs, const auto & rhs) {
+    return (lhs.first > rhs.first) || ((lhs.first == rhs.first) && (lhs.second < rhs.second));
+  });
+  std::vector<std::vector<int>> preferences;
+  double last_band = 0;
+  for(auto [value, partner]: scored) {
+    // A score of exactly 1 belongs to the band just below it.
+    double band = value;
+    if (_shape.tie_width > 0) {
+      band = std::floor(std::min(value, std::nextafter(1.0f, 0.0f)) / _shape.tie_width);
+    }
+    if (preferences.empty() || (band != last_band)) {
+      preferences.emplace_back();
+      last_band = band;
+    }
+    preferences.back().push_back(partner);
+  }
+  return preferences;
+}
+
+float InstanceGenerator::score(bool is_left, int id, int partner) const {
+  // What each purpose of hash() is for.
+  enum Purpose : uint64_t { LeftMaster = 1, RightMaster, LeftOpinion, RightOpinion, LeftPoint, RightPoint, Pair };
+  switch (_shape.family) {
+    case MasterList:
+    case Popularity: {
+      float shared;
+      if (_shape.family == MasterList) {
+        shared = hash(is_left ? RightMaster : LeftMaster, partner);
+      } else {
+        shared = 1 - (partner - 1) / (float)_size;
+      }
+      float own = hash(is_left ? LeftOpinion : RightOpinion, id, partner);
+      return (1 - _shape.noise) * shared + _shape.noise * own;
+    }
+    case Euclidean: {
+      double distance = 0;
+      for(int dimension = 0; dimension < _shape.dimensions; ++dimension) {
+        double difference = hash(is_left ? LeftPoint : RightPoint, id, dimension) -
+                            hash(is_left ? RightPoint : LeftPoint, partner, dimension);
+        distance += difference * difference;
+      }
+      return 1 - std::sqrt(distance / std::max(1, _shape.dimensions));
+    }
+    case GRP:
+      return is_left ? hash(Pair, id, partner) : hash(Pair, partner, id);
+    default:
+      return 0;
+  }
+}
+
+float InstanceGenerator::hash(uint64_t purpose, uint64_t first, uint64_t second) const {
+  SplitMix64 generator(_seed ^ (purpose * 0xd1b54a32d192ed03ULL), (first << 32) ^ second);
+  return generator.uniform_real();
+}
+
+void InstanceGenerator::for_each_agent(
+    const std::function<void(bool, int, const std::vector<std::vector<int>> &)> & visit,
+    size_t memory_limit) const {
+  for(int i = 1; i <= _size; ++i) {
+    visit(true, i, left(i));
+  }
+  // Each right agent is chosen pref_length times on average, so a batch
+  // holds about batch * pref_length preferences. Each agent also has a
+  // vector header and a heap block with its own bookkeeping, and growing by
+  // push_back can leave up to twice the capacity that is used.
+  const int64_t block_overhead = 2 * sizeof(void*);
+  int64_t per_agent = sizeof(std::vector<int>) + block_overhead + 2 * (int64_t)_pref_length * sizeof(int);
+  int batch = std::max<int64_t>(1, std::min<int64_t>(_size, memory_limit / per_agent));
+  std::vector<std::vector<int>> choosers(batch);
+  for(int first = 1; first <= _size; first += batch) {
+    int last = std::min<int64_t>(_size, (int64_t)first + batch - 1);
+    for(int i = 1; i <= _size; ++i) {
+      for(const std::vector<int> & tie: left(i)) {
+        for(int j: tie) {
+          if ((j >= first) && (j <= last)) {
+            choosers[j - first].push_back(i);
+          }
+        }
+      }
+    }
+    for(int j = first; j <= last; ++j) {
+      visit(false, j, right(j, std::move(choosers[j - first])));
+      choosers[j - first] = std::vector<int>();
+    }
+  }
+}
+
+void InstanceGenerator::write_text(const std::string & filename, size_t memory_limit) const {
+  std::ofstream out(filename);
+  out << _size << "\n" << _size << "\n";
+  for_each_agent([&out](bool, int id, const std::vector<std::vector<int>> & preferences) {
+    out << id << ":";
+    for(const std::vector<int> & tie: preferences) {
+      if (tie.size() == 1) {
+        out << " " << tie[0];
+      } else {
+        out << " [";
+        for(size_t k = 0; k < tie.size(); ++k) {
+          out << ((k > 0) ? " " : "") << tie[k];
+        }
+        out << "]";
+      }
+    }
+    out << "\n";
+  }, memory_limit);
+  if (!out) {
+    throw std::system_error(errno, std::generic_category(), "Could not write " + filename);
+  }
+}
+
+void InstanceGenerator::write_binary(const std::string & filename, size_t memory_limit) const {
+  // The first pass only counts the tie groups, which the header needs.
+  uint64_t num_groups = 0;
+  uint64_t num_prefs = 0;
+  for_each_agent([&num_groups, &num_prefs](bool, int, const std::vector<std::vector<int>> & preferences) {
+    num_groups += preferences.size();
+    for(const std::vector<int> & tie: preferences) {
+      num_prefs += tie.size();
+    }
+  }, memory_limit);
+
+  BinaryInstanceHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::copy(BinaryInstanceHeader::expected_magic, BinaryInstanceHeader::expected_magic + 8, header.magic);
+  header.version = BinaryInstanceHeader::current_version;
+  header.header_size = sizeof(header);
+  header.size = _size;
+  header.num_left = _size;
+  header.num_right = _size;
+  header.num_groups = num_groups;
+  header.num_prefs = num_prefs;
+
+  std::ofstream out(filename, std::ios::binary);
+  // The checksum is only known at the end, so the header is written again.
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  SectionWriter writer(out);
+  for(int side = 0; side < 2; ++side) {
+    for(int id = 1; id <= _size; ++id) {
+      writer.write<int32_t>(id);
+    }
+  }
+  writer.end_section();
+  int64_t group = 0;
+  for_each_agent([&writer, &group](bool, int, const std::vector<std::vector<int>> & preferences) {
+    writer.write<int64_t>(group);
+    group += preferences.size();
+  }, memory_limit);
+  writer.write<int64_t>(group);
+  writer.end_section();
+  int64_t pref = 0;
+  for_each_agent([&writer, &pref](bool, int, const std::vector<std::vector<int>> & preferences) {
+    for(const std::vector<int> & tie: preferences) {
+      writer.write<int64_t>(pref);
+      pref += tie.size();
+    }
+  }, memory_limit);
+  writer.write<int64_t>(pref);
+  writer.end_section();
+  for_each_agent([&writer](bool, int, const std::vector<std::vector<int>> & preferences) {
+    for(const std::vector<int> & tie: preferences) {
+      for(int id: tie) {
+        writer.write<int32_t>(id);
+      }
+    }
+  }, memory_limit);
+  writer.end_section();
+
+  header.checksum = writer.checksum();
+  out.seekp(0);
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  if (!out) {
+    throw std::system_error(errno, std::generic_category(), "Could not write " + filename);
+  }
+}
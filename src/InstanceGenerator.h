@@ -0,0 +1,119 @@
+#ifndef INSTANCE_GENERATOR_H
+#define INSTANCE_GENERATOR_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class SplitMix64;
+
+/**
+ * Random instances where every agent draws from its own stream derived from
+ * a seed, as built by SMTI(size, pref_length, tie_density, seed, threads).
+ * Since any agent can be generated again on its own, instances can also be
+ * written straight to a file, one agent at a time, without ever being held
+ * in memory.
+ */
+class InstanceGenerator {
+  public:
+    /**
+     * Kinds of instance.
+     * Uniform: Lists are uniformly random, and consecutive agents in a list
+     * are tied with probability tie_density.
+     * MasterList: Each side has a master list, a random score for every
+     * agent, which all agents on the other side follow.
+     * Euclidean: Agents are random points in the unit cube, and prefer
+     * agents closer to them.
+     * Popularity: Agents with smaller IDs are both more popular, with a
+     * Zipf distribution deciding who appears in lists, and better ranked.
+     * GRP: Every pair has a random score that both agents use, giving an
+     * instance with Globally Ranked Pairs.
+     * In every kind but Uniform, each agent finds a random set of
+     * pref_length agents acceptable, and ranks them by a score from 0 to 1.
+     */
+    enum Family { Uniform, MasterList, Euclidean, Popularity, GRP };
+
+    /**
+     * The parameters of an instance beyond its size.
+     */
+    struct Shape {
+      Family family = Uniform;
+      // For Uniform, the chance that consecutive agents are tied.
+      float tie_density = 0;
+      // For the other kinds, scores in the same multiple of tie_width are
+      // tied, so 0 gives no ties and 1 ties every list completely.
+      float tie_width = 0;
+      // For MasterList and Popularity, how much weight each agent gives its
+      // own random opinion of a pair over the shared score, from 0 to 1.
+      float noise = 0;
+      // For Euclidean, the number of dimensions.
+      int dimensions = 2;
+      // For Popularity, the exponent of the Zipf distribution.
+      float skew = 1;
+    };
+
+    InstanceGenerator(int size, int pref_length, float tie_density, uint64_t seed);
+
+    InstanceGenerator(int size, int pref_length, const Shape & shape, uint64_t seed);
+
+    int size() const { return _size; }
+
+    /**
+     * The preferences of the left agent with the given ID, from 1 to size.
+     */
+    std::vector<std::vector<int>> left(int id) const;
+
+    /**
+     * The preferences of the right agent with the given ID, where choosers
+     * are the left agents that find it acceptable, in increasing order.
+     */
+    std::vector<std::vector<int>> right(int id, std::vector<int> choosers) const;
+
+    /**
+     * Call visit for every left agent and then every right agent, in order
+     * of ID, with whether it is on the left, its ID and its preferences.
+     * The right agents are found in batches whose preference lists take
+     * about memory_limit bytes of heap, counting their vectors and spare
+     * capacity, generating every left agent again for each batch.
+     */
+    void for_each_agent(const std::function<void(bool, int, const std::vector<std::vector<int>> &)> & visit,
+                        size_t memory_limit = default_memory_limit) const;
+
+    /**
+     * Write the instance in the text format read by SMTI(filename). Throws
+     * std::system_error if the file cannot be written.
+     */
+    void write_text(const std::string & filename, size_t memory_limit = default_memory_limit) const;
+
+    /**
+     * Write the instance in the binary format of SMTI::save_binary(). The
+     * sections of the file are written in order, so the agents are
+     * generated three times. Throws std::system_error if the file cannot be
+     * written.
+     */
+    void write_binary(const std::string & filename, size_t memory_limit = default_memory_limit) const;
+
+    static constexpr size_t default_memory_limit = 256 << 20;
+
+  private:
+    // Choose the acceptable partners of a left agent.
+    std::vector<int> choose(SplitMix64 & generator) const;
+
+    // Sort partners by score, best first, and group them into ties.
+    std::vector<std::vector<int>> rank(bool is_left, int id, const std::vector<int> & partners) const;
+
+    // The score that an agent gives a partner.
+    float score(bool is_left, int id, int partner) const;
+
+    // A random number from 0 to 1 that depends only on the seed and the
+    // given values.
+    float hash(uint64_t purpose, uint64_t first, uint64_t second = 0) const;
+
+    int _size;
+    int _pref_length;
+    Shape _shape;
+    uint64_t _seed;
+};
+
+#endif /* INSTANCE_GENERATOR_H */
@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "InstanceView.h"
+
+namespace {
+  // Bytes taken by count elements of the given size, padded to 8 bytes.
+  uint64_t padded(uint64_t count, size_t element_size) {
+    return (count * element_size + 7) / 8 * 8;
+  }
+
+  // Whether count + 1 offsets run from 0 to end without decreasing, so that
+  // every range they give lies within an array of end elements.
+  bool valid_offsets(const int64_t * offsets, uint64_t count, uint64_t end) {
+    if ((offsets[0] != 0) || (uint64_t(offsets[count]) != end)) {
+      return false;
+    }
+    for(uint64_t index = 0; index < count; ++index) {
+      if (offsets[index] > offsets[index + 1]) {
+        return false;
+      }
+    }
+    return true;
+  }
+} // namespace
+
+uint64_t BinaryInstanceHeader::payload_size() const {
+  return padded(num_left + num_right, sizeof(int32_t)) +
+         padded(num_left + num_right + 1, sizeof(int64_t)) +
+         padded(num_groups + 1, sizeof(int64_t)) +
+         padded(num_prefs, sizeof(int32_t));
+}
+
+uint64_t BinaryInstanceHeader::compute_checksum(const char * data, size_t size) {
+  return continue_checksum(14695981039346656037ULL, data, size);
+}
+
+uint64_t BinaryInstanceHeader::continue_checksum(uint64_t hash, const char * data, size_t size) {
+  for(size_t offset = 0; offset < size; offset += 8) {
+    uint64_t word;
+    std::memcpy(&word, data + offset, sizeof(word));
+    hash ^= word;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+InstanceView::InstanceView(const std::string & filename) : _file(filename) {
+  if (_file.size() < sizeof(BinaryInstanceHeader)) {
+    throw std::invalid_argument(filename + " is not a binary instance");
+  }
+  _header = reinterpret_cast<const BinaryInstanceHeader *>(_file.data());
+  if (!std::equal(_header->magic, _header->magic + 8, BinaryInstanceHeader::expected_magic)) {
+    throw std::invalid_argument(filename + " is not a binary instance");
+  }
+  if ((_header->version != BinaryInstanceHeader::current_version) ||
+      (_header->header_size != sizeof(BinaryInstanceHeader))) {
+    throw std::invalid_argument(filename + " has an unsupported binary instance version");
+  }
+  // Every count is at most the size of the file, so payload_size() cannot
+  // overflow.
+  if ((_header->num_left > _file.size()) || (_header->num_right > _file.size()) ||
+      (_header->num_groups > _file.size()) || (_header->num_prefs > _file.size()) ||
+      (_file.size() != sizeof(BinaryInstanceHeader) + _header->payload_size())) {
+    throw std::invalid_argument(filename + " is truncated");
+  }
+  // mmap returns page-aligned memory and everything is padded to 8 bytes,
+  // so these are all suitably aligned.
+  const char * position = _file.data() + sizeof(BinaryInstanceHeader);
+  uint64_t num_agents = _header->num_left + _header->num_right;
+  _ids = reinterpret_cast<const int32_t *>(position);
+  position += padded(num_agents, sizeof(int32_t));
+  _agent_groups = reinterpret_cast<const int64_t *>(position);
+  position += padded(num_agents + 1, sizeof(int64_t));
+  _group_prefs = reinterpret_cast<const int64_t *>(position);
+  position += padded(_header->num_groups + 1, sizeof(int64_t));
+  _prefs = reinterpret_cast<const int32_t *>(position);
+  if (!valid_offsets(_agent_groups, num_agents, _header->num_groups) ||
+      !valid_offsets(_group_prefs, _header->num_groups, _header->num_prefs)) {
+    throw std::invalid_argument(filename + " has invalid offsets");
+  }
+}
+
+bool InstanceView::verify() const {
+  const char * payload = _file.data() + sizeof(BinaryInstanceHeader);
+  return BinaryInstanceHeader::compute_checksum(payload, _header->payload_size()) == _header->checksum;
+}
+
+long InstanceView::find(const int32_t * begin, const int32_t * end, int id) const {
+  const int32_t * found = std::lower_bound(begin, end, id);
+  if ((found == end) || (*found != id)) {
+    return -1;
+  }
+  return found - begin;
+}
+
+long InstanceView::left_index(int id) const {
+  return find(_ids, _ids + _header->num_left, id);
+}
+
+long InstanceView::right_index(int id) const {
+  return find(_ids + _header->num_left, _ids + _header->num_left + _header->num_right, id);
+}
+
+InstanceView::Range InstanceView::group(size_t agent, size_t rank) const {
+  int64_t group = _agent_groups[agent] + rank;
+  return Range(_prefs + _group_prefs[group], _prefs + _group_prefs[group + 1]);
+}
+
+InstanceView::Range InstanceView::prefs(size_t agent) const {
+  return Range(_prefs + _group_prefs[_agent_groups[agent]],
+               _prefs + _group_prefs[_agent_groups[agent + 1]]);
+}
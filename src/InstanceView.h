@@ -0,0 +1,144 @@
+#ifndef INSTANCE_VIEW_H
+#define INSTANCE_VIEW_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "MappedFile.h"
+
+/**
+ * The header of a binary instance file, as written by SMTI::save_binary().
+ * It is followed by these arrays, each padded to a multiple of 8 bytes:
+ *  - the IDs of the left agents and then the right agents, each side in
+ *    increasing order of ID (int32_t);
+ *  - for each agent, in the same order, the index of its first tie group,
+ *    and then the total number of tie groups (int64_t);
+ *  - for each tie group, the index of its first preference, and then the
+ *    total number of preferences (int64_t);
+ *  - the preferences, as IDs of agents on the other side (int32_t).
+ * Everything is in the byte order of the machine that wrote the file. The
+ * checksum covers everything after the header.
+ */
+struct BinaryInstanceHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  int64_t size;
+  int64_t num_dummies;
+  uint64_t num_left;
+  uint64_t num_right;
+  uint64_t num_groups;
+  uint64_t num_prefs;
+  uint64_t checksum;
+
+  static constexpr char expected_magic[8] = {'S', 'M', 'T', 'I', 'B', 'I', 'N', 0};
+  static constexpr uint32_t current_version = 1;
+
+  /**
+   * The number of bytes of arrays that follow the header.
+   */
+  uint64_t payload_size() const;
+
+  /**
+   * Checksum of the given data, a 64-bit FNV-1a hash taken over 8-byte
+   * words. size must be a multiple of 8.
+   */
+  static uint64_t compute_checksum(const char * data, size_t size);
+
+  /**
+   * Continue a checksum from compute_checksum() with more data, so that it
+   * can be computed while writing a file in pieces. size must be a multiple
+   * of 8.
+   */
+  static uint64_t continue_checksum(uint64_t hash, const char * data, size_t size);
+};
+
+/**
+ * Read-only access to a binary instance file, without copying or parsing
+ * it. Opening the file checks the header and that the offsets of agents and
+ * tie groups stay within their arrays, so takes time linear in the number
+ * of agents and tie groups but not in the preferences, and the pages of the
+ * file are shared by all processes that open it.
+ */
+class InstanceView {
+  public:
+    /**
+     * A run of agent IDs in the file.
+     */
+    class Range {
+      public:
+        Range(const int32_t * begin, const int32_t * end) : _begin(begin), _end(end) { }
+        const int32_t * begin() const { return _begin; }
+        const int32_t * end() const { return _end; }
+        size_t size() const { return _end - _begin; }
+        int operator[](size_t index) const { return _begin[index]; }
+      private:
+        const int32_t * _begin;
+        const int32_t * _end;
+    };
+
+    /**
+     * Open a file written by SMTI::save_binary(). Throws std::system_error
+     * if it cannot be read, and std::invalid_argument if it is not a
+     * binary instance of a version this library can read, or its offsets
+     * are out of order or out of range.
+     */
+    explicit InstanceView(const std::string & filename);
+
+    /**
+     * Check the checksum, which needs to read the whole file.
+     */
+    bool verify() const;
+
+    const BinaryInstanceHeader & header() const { return *_header; }
+
+    size_t num_agents_left() const { return _header->num_left; }
+    size_t num_agents_right() const { return _header->num_right; }
+
+    /**
+     * The ID of the agent at the given index. Agents are indexed in order
+     * of ID on each side.
+     */
+    int left_id(size_t index) const { return _ids[index]; }
+    int right_id(size_t index) const { return _ids[_header->num_left + index]; }
+
+    /**
+     * The index of the agent with the given ID, or -1 if there is none.
+     */
+    long left_index(int id) const;
+    long right_index(int id) const;
+
+    /**
+     * The number of tie groups of the agent at the given index.
+     */
+    size_t num_groups_left(size_t index) const { return num_groups(index); }
+    size_t num_groups_right(size_t index) const { return num_groups(_header->num_left + index); }
+
+    /**
+     * The tie group at the given rank, for the agent at the given index.
+     */
+    Range group_left(size_t index, size_t rank) const { return group(index, rank); }
+    Range group_right(size_t index, size_t rank) const { return group(_header->num_left + index, rank); }
+
+    /**
+     * All preferences, in order, of the agent at the given index.
+     */
+    Range prefs_left(size_t index) const { return prefs(index); }
+    Range prefs_right(size_t index) const { return prefs(_header->num_left + index); }
+
+  private:
+    size_t num_groups(size_t agent) const { return _agent_groups[agent + 1] - _agent_groups[agent]; }
+    Range group(size_t agent, size_t rank) const;
+    Range prefs(size_t agent) const;
+    long find(const int32_t * begin, const int32_t * end, int id) const;
+
+    MappedFile _file;
+    const BinaryInstanceHeader * _header;
+    const int32_t * _ids;
+    const int64_t * _agent_groups;
+    const int64_t * _group_prefs;
+    const int32_t * _prefs;
+};
+
+#endif /* INSTANCE_VIEW_H */
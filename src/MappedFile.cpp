@@ -0,0 +1,52 @@
+#include <cerrno>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "MappedFile.h"
+
+MappedFile::MappedFile(const std::string & filename) : _data(nullptr), _size(0) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(), "Could not open " + filename);
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    int error = errno;
+    close(fd);
+    throw std::system_error(error, std::generic_category(), "Could not read " + filename);
+  }
+  _size = info.st_size;
+  if (_size > 0) {
+    void * mapped = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+      int error = errno;
+      close(fd);
+      throw std::system_error(error, std::generic_category(), "Could not map " + filename);
+    }
+    // Files are read front to back, so ask for aggressive read-ahead.
+    madvise(mapped, _size, MADV_SEQUENTIAL);
+    _data = static_cast<const char *>(mapped);
+  }
+  // The mapping stays valid after the file is closed.
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (_data != nullptr) {
+    munmap(const_cast<char *>(_data), _size);
+  }
+}
+
+MappedFile::MappedFile(MappedFile && other) noexcept :
+  _data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0)) { }
+
+MappedFile & MappedFile::operator=(MappedFile && other) noexcept {
+  std::swap(_data, other._data);
+  std::swap(_size, other._size);
+  return *this;
+}
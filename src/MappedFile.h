@@ -0,0 +1,41 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * A file mapped read-only into memory, for as long as this object exists.
+ */
+class MappedFile {
+  public:
+    /**
+     * Map the whole of the given file. Throws std::system_error if the file
+     * cannot be opened or mapped.
+     */
+    explicit MappedFile(const std::string & filename);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile & operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile && other) noexcept;
+    MappedFile & operator=(MappedFile && other) noexcept;
+
+    /**
+     * The contents of the file. Not null-terminated, and nullptr for an
+     * empty file.
+     */
+    const char * data() const { return _data; }
+
+    /**
+     * The size of the file in bytes.
+     */
+    size_t size() const { return _size; }
+
+  private:
+    const char * _data;
+    size_t _size;
+};
+
+#endif /* MAPPED_FILE_H */
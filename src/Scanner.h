@@ -0,0 +1,141 @@
+#ifndef SCANNER_H
+#define SCANNER_H
+
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+/**
+ * Reads integers, identifiers and punctuation from text in memory, without copying it,
+ * keeping track of the line number for error messages. Spaces, tabs and
+ * carriage returns separate tokens, but newlines must be skipped explicitly
+ * with next_line().
+ */
+class Scanner {
+  public:
+    Scanner(const char * begin, const char * end, int line = 1) :
+      _cur(begin), _end(end), _line(line) { }
+
+    bool at_end() const { return _cur == _end; }
+
+    bool at_line_end() const { return (_cur == _end) || (*_cur == '\n'); }
+
+    /**
+     * The current position in the text.
+     */
+    const char * position() const { return _cur; }
+
+    int line() const { return _line; }
+
+    /**
+     * Skip spaces, tabs and carriage returns.
+     */
+    void skip_blanks() {
+      while ((_cur != _end) && ((*_cur == ' ') || (*_cur == '\t') || (*_cur == '\r'))) {
+        ++_cur;
+      }
+    }
+
+    /**
+     * Skip to the start of the next line.
+     */
+    void next_line() {
+      while ((_cur != _end) && (*_cur != '\n')) {
+        ++_cur;
+      }
+      if (_cur != _end) {
+        ++_cur;
+        ++_line;
+      }
+    }
+
+    /**
+     * Skip any lines that contain nothing but blanks.
+     */
+    void skip_empty_lines() {
+      for(;;) {
+        const char * start = _cur;
+        skip_blanks();
+        if ((_cur == _end) || (*_cur != '\n')) {
+          _cur = start;
+          return;
+        }
+        next_line();
+      }
+    }
+
+    /**
+     * If the next character is c, skip it and return true.
+     */
+    bool accept(char c) {
+      if ((_cur != _end) && (*_cur == c)) {
+        ++_cur;
+        return true;
+      }
+      return false;
+    }
+
+    /**
+     * Read a (possibly negative) integer starting at the current position.
+     */
+    int read_int() {
+      bool negative = accept('-');
+      if ((_cur == _end) || (*_cur < '0') || (*_cur > '9')) {
+        fail("expected a number");
+      }
+      long limit = negative ? 2147483648L : 2147483647L;
+      long value = 0;
+      while ((_cur != _end) && (*_cur >= '0') && (*_cur <= '9')) {
+        value = value * 10 + (*_cur - '0');
+        if (value > limit) {
+          fail("number too large");
+        }
+        ++_cur;
+      }
+      return negative ? -value : value;
+    }
+
+    /**
+     * Read an identifier starting at the current position, which runs up to
+     * the next blank, newline or any of ":[]()".
+     */
+    std::string_view read_token() {
+      const char * start = _cur;
+      while ((_cur != _end) && (std::strchr(" \t\r\n:[]()", *_cur) == nullptr)) {
+        ++_cur;
+      }
+      if (_cur == start) {
+        fail("expected an ID");
+      }
+      return std::string_view(start, _cur - start);
+    }
+
+    /**
+     * Read a floating point number starting at the current position.
+     */
+    float read_float() {
+      float value;
+      std::from_chars_result result = std::from_chars(_cur, _end, value);
+      if (result.ec != std::errc()) {
+        fail("expected a number");
+      }
+      _cur = result.ptr;
+      return value;
+    }
+
+    /**
+     * Throw std::invalid_argument describing a problem at the current line.
+     */
+    [[noreturn]] void fail(const std::string & what) const {
+      throw std::invalid_argument("Line " + std::to_string(_line) + ": " + what);
+    }
+
+  private:
+    const char * _cur;
+    const char * _end;
+    int _line;
+};
+
+#endif /* SCANNER_H */
@@ -0,0 +1,63 @@
+#ifndef SPLIT_MIX_64_H
+#define SPLIT_MIX_64_H
+
+#include <cstdint>
+#include <limits>
+
+/**
+ * The SplitMix64 generator, small enough to give every agent its own stream.
+ * A stream is fixed by a seed and an index, so the numbers an agent gets do
+ * not depend on which thread creates it, or in which order. Satisfies
+ * UniformRandomBitGenerator, so it also works with the standard
+ * distributions.
+ */
+class SplitMix64 {
+  public:
+    using result_type = uint64_t;
+
+    SplitMix64(uint64_t seed, uint64_t stream) :
+      _state(mix(seed ^ mix(stream + 0x9e3779b97f4a7c15ULL))) { }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    result_type operator()() {
+      _state += 0x9e3779b97f4a7c15ULL;
+      return mix(_state);
+    }
+
+    /**
+     * A uniformly distributed integer in [0, bound), for bound > 0, with
+     * Lemire's multiply and reject method.
+     */
+    uint64_t uniform(uint64_t bound) {
+      unsigned __int128 product = (unsigned __int128)(*this)() * bound;
+      uint64_t low = (uint64_t)product;
+      if (low < bound) {
+        uint64_t threshold = -bound % bound;
+        while (low < threshold) {
+          product = (unsigned __int128)(*this)() * bound;
+          low = (uint64_t)product;
+        }
+      }
+      return product >> 64;
+    }
+
+    /**
+     * A uniformly distributed float in [0, 1).
+     */
+    float uniform_real() {
+      return ((*this)() >> 40) * (1.0f / (1 << 24));
+    }
+
+  private:
+    static uint64_t mix(uint64_t z) {
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      return z ^ (z >> 31);
+    }
+
+    uint64_t _state;
+};
+
+#endif /* SPLIT_MIX_64_H */
@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <vector>
+
+#ifdef SMTI_INSTRUMENTATION
+#include <malloc.h>
+#endif
+
+#include "Stats.h"
+
+namespace {
+  struct Event {
+    const char * name;
+    int64_t start;
+    int64_t duration;
+    int thread;
+    int64_t peak_bytes;
+  };
+
+  // Phases and counters are kept in deques, so that references to them stay
+  // valid as more are added.
+  std::mutex registry_mutex;
+  std::deque<Stats::Phase> all_phases;
+  std::deque<Stats::Counter> all_counters;
+
+  std::atomic<bool> tracing{false};
+  std::mutex trace_mutex;
+  std::vector<Event> events;
+  const auto trace_start = std::chrono::steady_clock::now();
+
+  // Small numbers for threads, in order of first use, for the trace.
+  int thread_number() {
+    static std::atomic<int> next{0};
+    thread_local int number = next++;
+    return number;
+  }
+
+  // Bytes on the heap for the whole process, and for this thread along with
+  // its peak since the innermost phase it is running started. Memory freed
+  // by another thread than allocated it makes the counts per thread drift,
+  // so they are only compared within a phase.
+  std::atomic<int64_t> heap_bytes{0};
+  std::atomic<int64_t> heap_peak{0};
+  thread_local int64_t thread_bytes = 0;
+  thread_local int64_t thread_peak = 0;
+
+  template <typename T>
+  void raise_peak(std::atomic<T> & peak, T value) {
+    T seen = peak.load(std::memory_order_relaxed);
+    while ((value > seen) && !peak.compare_exchange_weak(seen, value, std::memory_order_relaxed)) { }
+  }
+
+#ifdef SMTI_INSTRUMENTATION
+  void allocated(int64_t bytes) {
+    raise_peak(heap_peak, heap_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+    thread_bytes += bytes;
+    thread_peak = std::max(thread_peak, thread_bytes);
+  }
+#endif
+} // namespace
+
+#ifdef SMTI_INSTRUMENTATION
+void * operator new(std::size_t size) {
+  void * pointer = std::malloc(size == 0 ? 1 : size);
+  if (pointer == nullptr) {
+    throw std::bad_alloc();
+  }
+  allocated(malloc_usable_size(pointer));
+  return pointer;
+}
+
+void * operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void * pointer) noexcept {
+  if (pointer != nullptr) {
+    allocated(-int64_t(malloc_usable_size(pointer)));
+    std::free(pointer);
+  }
+}
+
+void operator delete[](void * pointer) noexcept {
+  operator delete(pointer);
+}
+
+void operator delete(void * pointer, std::size_t) noexcept {
+  operator delete(pointer);
+}
+
+void operator delete[](void * pointer, std::size_t) noexcept {
+  operator delete(pointer);
+}
+#endif
+
+bool Stats::enabled() {
+#ifdef SMTI_INSTRUMENTATION
+  return true;
+#else
+  return false;
+#endif
+}
+
+Stats::Phase & Stats::phase(const char * name) {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  for(Phase & existing: all_phases) {
+    if (std::strcmp(existing.name, name) == 0) {
+      return existing;
+    }
+  }
+  all_phases.emplace_back();
+  all_phases.back().name = name;
+  return all_phases.back();
+}
+
+Stats::Counter & Stats::counter(const char * name) {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  for(Counter & existing: all_counters) {
+    if (std::strcmp(existing.name, name) == 0) {
+      return existing;
+    }
+  }
+  all_counters.emplace_back();
+  all_counters.back().name = name;
+  return all_counters.back();
+}
+
+Stats::Scope::Scope(Phase & phase) : _phase(phase), _start(std::chrono::steady_clock::now()),
+                                      _start_bytes(thread_bytes), _outer_peak(thread_peak) {
+  thread_peak = thread_bytes;
+}
+
+Stats::Scope::~Scope() {
+  auto end = std::chrono::steady_clock::now();
+  int64_t duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - _start).count();
+  int64_t peak = thread_peak - _start_bytes;
+  // The peak of this phase is also one of the enclosing phase.
+  thread_peak = std::max(thread_peak, _outer_peak);
+  _phase.calls.fetch_add(1, std::memory_order_relaxed);
+  _phase.nanoseconds.fetch_add(duration, std::memory_order_relaxed);
+  raise_peak(_phase.peak_bytes, uint64_t(peak));
+  if (tracing.load(std::memory_order_relaxed)) {
+    int64_t start = std::chrono::duration_cast<std::chrono::nanoseconds>(_start - trace_start).count();
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    events.push_back({_phase.name, start, duration, thread_number(), peak});
+  }
+}
+
+std::map<std::string, Stats::Timer> Stats::timers() {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  std::map<std::string, Timer> result;
+  for(const Phase & entry: all_phases) {
+    Timer & timer = result[entry.name];
+    timer.calls = entry.calls.load();
+    timer.seconds = entry.nanoseconds.load() / 1e9;
+    timer.peak_bytes = entry.peak_bytes.load();
+  }
+  return result;
+}
+
+std::map<std::string, uint64_t> Stats::counters() {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  std::map<std::string, uint64_t> result;
+  for(const Counter & entry: all_counters) {
+    result[entry.name] = entry.value.load();
+  }
+  return result;
+}
+
+int64_t Stats::current_bytes() {
+  return heap_bytes.load();
+}
+
+int64_t Stats::peak_bytes() {
+  return heap_peak.load();
+}
+
+void Stats::reset() {
+  heap_peak = heap_bytes.load();
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for(Phase & entry: all_phases) {
+      entry.calls = 0;
+      entry.nanoseconds = 0;
+      entry.peak_bytes = 0;
+    }
+    for(Counter & entry: all_counters) {
+      entry.value = 0;
+    }
+  }
+  std::lock_guard<std::mutex> lock(trace_mutex);
+  events.clear();
+}
+
+void Stats::trace(bool on) {
+  tracing = on;
+}
+
+void Stats::write_trace(const std::string & filename) {
+  std::ofstream out(filename);
+  out << "{\"traceEvents\": [";
+  bool first = true;
+  int64_t last = 0;
+  {
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    for(const Event & event: events) {
+      // Times are in microseconds.
+      out << (first ? "\n" : ",\n") << "  {\"name\": \"" << event.name << "\", \"ph\": \"X\", \"ts\": "
+          << event.start / 1000.0 << ", \"dur\": " << event.duration / 1000.0
+          << ", \"pid\": 1, \"tid\": " << event.thread << ", \"args\": {\"peak_bytes\": "
+          << event.peak_bytes << "}}";
+      first = false;
+      last = std::max(last, event.start + event.duration);
+    }
+  }
+  std::map<std::string, uint64_t> values = counters();
+  if (!values.empty()) {
+    out << (first ? "\n" : ",\n") << "  {\"name\": \"counters\", \"ph\": \"C\", \"ts\": " << last / 1000.0
+        << ", \"pid\": 1, \"args\": {";
+    bool first_value = true;
+    for(auto & [name, value]: values) {
+      out << (first_value ? "" : ", ") << "\"" << name << "\": " << value;
+      first_value = false;
+    }
+    out << "}}";
+  }
+  out << "\n]}\n";
+  if (!out) {
+    throw std::system_error(errno, std::generic_category(), "Could not write " + filename);
+  }
+}
@@ -0,0 +1,118 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+
+/**
+ * Timers and counters for the phases of the library, such as parsing,
+ * preprocessing, each encoding and building and solving IP models. They are
+ * only compiled in if SMTI_INSTRUMENTATION is defined, which configuring
+ * with -DINSTRUMENTATION=ON does. Otherwise SMTI_TIME() and SMTI_COUNT()
+ * expand to nothing, and Stats reports nothing.
+ *
+ * Instrumented builds also replace the global operator new and delete, to
+ * count the bytes allocated on the heap by the process and by each phase.
+ */
+class Stats {
+  public:
+    /**
+     * How often a phase ran, and for how long in total. Time spent in a
+     * phase that runs inside another counts towards both.
+     */
+    struct Timer {
+      uint64_t calls = 0;
+      double seconds = 0;
+      // The most bytes held by the thread running the phase, over what it
+      // held when the phase started, in any one run. Allocations made by
+      // other threads the phase starts are not included.
+      uint64_t peak_bytes = 0;
+    };
+
+    /**
+     * Whether the library was built with instrumentation.
+     */
+    static bool enabled();
+
+    static std::map<std::string, Timer> timers();
+    static std::map<std::string, uint64_t> counters();
+
+    /**
+     * Bytes allocated with operator new and not yet deleted, now and at
+     * most since the last reset().
+     */
+    static int64_t current_bytes();
+    static int64_t peak_bytes();
+
+    /**
+     * Set every timer and counter back to zero, forget any trace, and start
+     * the peak of the heap again from its current size.
+     */
+    static void reset();
+
+    /**
+     * Start or stop keeping every run of every phase, for write_trace().
+     */
+    static void trace(bool on);
+
+    /**
+     * Write the phases kept since trace(true) in the Chrome trace event
+     * format, which chrome://tracing and Perfetto read, with the counters
+     * at the end. Throws std::system_error if the file cannot be written.
+     */
+    static void write_trace(const std::string & filename);
+
+    // What follows is used by the macros below.
+    struct Phase {
+      const char * name;
+      std::atomic<uint64_t> calls{0};
+      std::atomic<uint64_t> nanoseconds{0};
+      std::atomic<uint64_t> peak_bytes{0};
+    };
+
+    struct Counter {
+      const char * name;
+      std::atomic<uint64_t> value{0};
+    };
+
+    static Phase & phase(const char * name);
+    static Counter & counter(const char * name);
+
+    class Scope {
+      public:
+        explicit Scope(Phase & phase);
+        ~Scope();
+      private:
+        Phase & _phase;
+        std::chrono::steady_clock::time_point _start;
+        // The bytes held by this thread when the phase started, and the peak
+        // of the enclosing phase until then.
+        int64_t _start_bytes;
+        int64_t _outer_peak;
+    };
+};
+
+#define SMTI_STATS_JOIN2(a, b) a##b
+#define SMTI_STATS_JOIN(a, b) SMTI_STATS_JOIN2(a, b)
+
+#ifdef SMTI_INSTRUMENTATION
+// Time the rest of the enclosing scope as the phase with the given name,
+// which must be a string literal.
+#define SMTI_TIME(name) \
+  static Stats::Phase & SMTI_STATS_JOIN(smti_phase_, __LINE__) = Stats::phase(name); \
+  Stats::Scope SMTI_STATS_JOIN(smti_scope_, __LINE__)(SMTI_STATS_JOIN(smti_phase_, __LINE__))
+// Add amount to the counter with the given name.
+#define SMTI_COUNT(name, amount) \
+  do { \
+    static Stats::Counter & smti_counter = Stats::counter(name); \
+    smti_counter.value.fetch_add(amount, std::memory_order_relaxed); \
+  } while (0)
+#else
+#define SMTI_TIME(name)
+#define SMTI_COUNT(name, amount) do { } while (0)
+#endif /* SMTI_INSTRUMENTATION */
+
+#endif /* STATS_H */
@@ -1,7 +1,12 @@
-#include <fstream>
+#include <cstring>
+#include <exception>
 #include <sstream>
 #include <set>
+#include <thread>
 
+#include "MappedFile.h"
+#include "Scanner.h"
+#include "Stats.h"
 #include "smti.h"
 
 SMTI::SMTI(int size, int pref_length, float tie_density, std::mt19937 & generator) :
@@ -27,104 +32,261 @@ SMTI::SMTI(int size, int pref_length, float tie_density, std::mt19937 & generato
 }
 
 
+namespace {
+  // Read a line containing just a number.
+  int read_count(Scanner & scanner) {
+    scanner.skip_empty_lines();
+    scanner.skip_blanks();
+    int count = scanner.read_int();
+    scanner.skip_blanks();
+    if (!scanner.at_line_end()) {
+      scanner.fail("expected a single number");
+    }
+    scanner.next_line();
+    return count;
+  }
+
+  // Read the line for one agent: its ID, optionally followed by ':' and (in
+  // the format of 1810.02711) a capacity, which is ignored, and then its
+  // preferences. Ties are written as a group of IDs in [] or (). read_own
+  // and read_other read the ID of the agent and of those it ranks.
+  template <typename ReadOwn, typename ReadOther>
+  int read_agent(Scanner & scanner, bool capacity, std::vector<std::vector<int>> & preferences,
+                 ReadOwn read_own, ReadOther read_other) {
+    scanner.skip_empty_lines();
+    scanner.skip_blanks();
+    int id = read_own();
+    scanner.skip_blanks();
+    scanner.accept(':');
+    if (capacity) {
+      scanner.skip_blanks();
+      scanner.read_int();
+      scanner.skip_blanks();
+      scanner.accept(':');
+    }
+    for(;;) {
+      scanner.skip_blanks();
+      if (scanner.at_line_end()) {
+        break;
+      }
+      if (scanner.accept('[') || scanner.accept('(')) {
+        std::vector<int> tie;
+        for(;;) {
+          scanner.skip_blanks();
+          if (scanner.accept(']') || scanner.accept(')')) {
+            break;
+          }
+          if (scanner.at_line_end()) {
+            scanner.fail("tie not closed");
+          }
+          tie.push_back(read_other());
+        }
+        if (!tie.empty()) {
+          preferences.push_back(std::move(tie));
+        }
+      } else {
+        preferences.push_back(std::vector<int>(1, read_other()));
+      }
+    }
+    scanner.next_line();
+    return id;
+  }
+
+  int read_agent(Scanner & scanner, bool capacity, std::vector<std::vector<int>> & preferences) {
+    auto read_id = [&scanner]() { return scanner.read_int(); };
+    return read_agent(scanner, capacity, preferences, read_id, read_id);
+  }
+} // namespace
+
 SMTI::SMTI(std::string filename) : _num_dummies(0) {
-  std::ifstream infile(filename);
-  std::string line;
-  getline(infile, line);
-  _size = std::stoi(line);
+  SMTI_TIME("parse");
+  MappedFile file(filename);
+  Scanner scanner(file.data(), file.data() + file.size());
+  _size = read_count(scanner);
   bool expect_capacity = false;
   if (_size == 0) {
     // Probably reading a file in format for 1810.02711
-    getline(infile, line);
-    _size = std::stoi(line);
+    _size = read_count(scanner);
     expect_capacity = true;
   }
-  getline(infile, line);
-  int second_size = std::stoi(line);
+  int second_size = read_count(scanner);
+  _ones.reserve(_size);
+  _twos.reserve(second_size);
 
   for(int lineno = 0; lineno < _size; ++lineno) {
-    int id;
-    getline(infile, line);
-    std::stringstream prefstream(line);
-    prefstream >> id;
-    std::string token;
     std::vector<std::vector<int>> preferences;
-    std::vector<int> tie;
-    bool in_tie = false;
-    while (prefstream >> token) {
-      if (token == ":") {
-        continue;
-      }
-      if ((token.front() == '[') || (token.front() == '('))  {
-        token.erase(0, 1); // Remove [
-        in_tie = true;
-      }
-      if ((token.back() == ']')  || (token.back() == ')')) {
-        token.pop_back();
-        int i = std::stoi(token);
-        tie.push_back(i);
-        preferences.push_back(std::move(tie));
-        tie = std::vector<int>();
-        in_tie = false;
-      } else if (in_tie) {
-        int i = std::stoi(token);
-        tie.push_back(i);
-      } else { // Not in tie
-        int i = std::stoi(token);
-        std::vector<int> here;
-        here.push_back(i);
-        preferences.push_back(std::move(here));
-      }
+    int id = read_agent(scanner, false, preferences);
+    _ones.emplace(id, Agent(id, std::move(preferences)));
+  }
+  for(int lineno = 0; lineno < second_size; ++lineno) {
+    std::vector<std::vector<int>> preferences;
+    int id = read_agent(scanner, expect_capacity, preferences);
+    _twos.emplace(id, Agent(id, std::move(preferences)));
+  }
+}
+
+SMTI SMTI::load_labelled(const std::string & filename) {
+  SMTI_TIME("parse_labelled");
+  MappedFile file(filename);
+  Scanner scanner(file.data(), file.data() + file.size());
+  SMTI instance;
+  instance._size = read_count(scanner);
+  bool expect_capacity = false;
+  if (instance._size == 0) {
+    instance._size = read_count(scanner);
+    expect_capacity = true;
+  }
+  int second_size = read_count(scanner);
+  auto left = std::make_shared<IdMap<std::string>>(1);
+  auto right = std::make_shared<IdMap<std::string>>(1);
+  auto read_left = [&scanner, &left]() { return left->add(std::string(scanner.read_token())); };
+  auto read_right = [&scanner, &right]() { return right->add(std::string(scanner.read_token())); };
+  instance._ones.reserve(instance._size);
+  instance._twos.reserve(second_size);
+  for(int lineno = 0; lineno < instance._size; ++lineno) {
+    std::vector<std::vector<int>> preferences;
+    int id = read_agent(scanner, false, preferences, read_left, read_right);
+    if (!instance._ones.emplace(id, Agent(id, std::move(preferences))).second) {
+      throw std::invalid_argument("Agent " + left->key(id) + " is given twice");
     }
-    _ones.emplace(id, Agent(id, preferences));
   }
   for(int lineno = 0; lineno < second_size; ++lineno) {
-    int id;
-    getline(infile, line);
-    std::stringstream prefstream(line);
-    prefstream >> id;
-    std::string token;
     std::vector<std::vector<int>> preferences;
-    std::vector<int> tie;
-    bool in_tie = false;
-    bool need_capacity = expect_capacity;
-    while (prefstream >> token) {
-      if (token == ":") {
-        continue;
-      }
-      if (need_capacity) {
-        // We just pulled in the capacity, which is hopefully 1, but we ignore
-        // it.
-        need_capacity = false;
-        continue;
+    int id = read_agent(scanner, expect_capacity, preferences, read_right, read_left);
+    if (!instance._twos.emplace(id, Agent(id, std::move(preferences))).second) {
+      throw std::invalid_argument("Agent " + right->key(id) + " is given twice");
+    }
+  }
+  for(auto [labels, agents]: {std::make_pair(left.get(), &instance._ones),
+                              std::make_pair(right.get(), &instance._twos)}) {
+    for(int id = labels->first(); id < labels->first() + labels->size(); ++id) {
+      if (agents->count(id) == 0) {
+        throw std::invalid_argument("Agent " + labels->key(id) + " is ranked but not given");
       }
-      if ((token.front() == '[') || (token.front() == '(')) {
-        token.erase(0, 1); // Remove [
-        in_tie = true;
+    }
+  }
+  instance._left_labels = std::move(left);
+  instance._right_labels = std::move(right);
+  return instance;
+}
+
+SMTI::SMTI(std::string filename, int threads) : _num_dummies(0) {
+  SMTI_TIME("parse_parallel");
+  if (threads <= 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  MappedFile file(filename);
+  const char * end = file.data() + file.size();
+  Scanner scanner(file.data(), end);
+  _size = read_count(scanner);
+  bool expect_capacity = false;
+  if (_size == 0) {
+    // Probably reading a file in format for 1810.02711
+    _size = read_count(scanner);
+    expect_capacity = true;
+  }
+  int second_size = read_count(scanner);
+  int num_agents = _size + second_size;
+
+  // Split the agent lines into one chunk per thread, at line boundaries.
+  std::vector<const char *> bounds(threads + 1);
+  bounds[0] = scanner.position();
+  bounds[threads] = end;
+  for(int chunk = 1; chunk < threads; ++chunk) {
+    const char * split = bounds[0] + (end - bounds[0]) * chunk / threads;
+    split = std::max(split, bounds[chunk - 1]);
+    const char * newline = static_cast<const char *>(std::memchr(split, '\n', end - split));
+    bounds[chunk] = (newline == nullptr) ? end : newline + 1;
+  }
+  struct Chunk {
+    int lines = 0;
+    int agents = 0;
+    std::vector<std::pair<int, Agent>> ones;
+    std::vector<std::pair<int, Agent>> twos;
+    std::exception_ptr error;
+  };
+  std::vector<Chunk> chunks(threads);
+  auto run = [threads](const std::function<void(int)> & work) {
+    std::vector<std::thread> pool;
+    for(int chunk = 1; chunk < threads; ++chunk) {
+      pool.emplace_back(work, chunk);
+    }
+    work(0);
+    for(std::thread & thread: pool) {
+      thread.join();
+    }
+  };
+
+  // First count the lines, and the agents (i.e., lines that are not empty),
+  // in each chunk, so that every chunk knows which agents it holds.
+  run([&bounds, &chunks](int chunk) {
+    Scanner counter(bounds[chunk], bounds[chunk + 1]);
+    while (!counter.at_end()) {
+      counter.skip_blanks();
+      if (!counter.at_line_end()) {
+        chunks[chunk].agents++;
       }
-      if ((token.back() == ']') || (token.back() == ')')) {
-        token.pop_back();
-        int i = std::stoi(token);
-        tie.push_back(i);
-        preferences.push_back(std::move(tie));
-        tie = std::vector<int>();
-        in_tie = false;
-      } else if (in_tie) {
-        int i = std::stoi(token);
-        tie.push_back(i);
-      } else { // Not in tie
-        int i = std::stoi(token);
-        std::vector<int> here;
-        here.push_back(i);
-        preferences.push_back(std::move(here));
+      counter.next_line();
+    }
+    chunks[chunk].lines = counter.line() - 1;
+  });
+  std::vector<int> first_line(threads);
+  std::vector<int> first_agent(threads);
+  int line = scanner.line();
+  int agents = 0;
+  for(int chunk = 0; chunk < threads; ++chunk) {
+    first_line[chunk] = line;
+    first_agent[chunk] = agents;
+    line += chunks[chunk].lines;
+    agents += chunks[chunk].agents;
+  }
+  if (agents < num_agents) {
+    throw std::invalid_argument("Line " + std::to_string(line) + ": expected " +
+                                std::to_string(num_agents) + " agents, found " +
+                                std::to_string(agents));
+  }
+
+  // Then parse the chunks, building the agents in the worker threads too.
+  run([&](int chunk) {
+    try {
+      Scanner reader(bounds[chunk], bounds[chunk + 1], first_line[chunk]);
+      int last = std::min(first_agent[chunk] + chunks[chunk].agents, num_agents);
+      for(int agent = first_agent[chunk]; agent < last; ++agent) {
+        bool left = agent < _size;
+        std::vector<std::vector<int>> preferences;
+        int id = read_agent(reader, !left && expect_capacity, preferences);
+        (left ? chunks[chunk].ones : chunks[chunk].twos).emplace_back(id, Agent(id, std::move(preferences)));
       }
+    } catch (...) {
+      chunks[chunk].error = std::current_exception();
+    }
+  });
+
+  // Stitch the chunks together in order, so the result is exactly as if
+  // read sequentially.
+  _ones.reserve(_size);
+  _twos.reserve(second_size);
+  for(Chunk & chunk: chunks) {
+    if (chunk.error) {
+      std::rethrow_exception(chunk.error);
+    }
+    for(auto & [id, agent]: chunk.ones) {
+      _ones.emplace(id, std::move(agent));
+    }
+    for(auto & [id, agent]: chunk.twos) {
+      _twos.emplace(id, std::move(agent));
     }
-    _twos.emplace(id, Agent(id, preferences));
   }
 }
 
 SMTI::SMTI(const SMTI & old) {
   _size = old._size;
+  _num_dummies = old._num_dummies;
+  _grp = old._grp;
+  _grp_threshold = old._grp_threshold;
+  _memory_budget = old._memory_budget;
+  _left_labels = old._left_labels;
+  _right_labels = old._right_labels;
   for(auto [id, left]: old.agents_left()) {
     _ones.emplace(id, Agent(id, left.preferences()));
   }
@@ -168,6 +330,7 @@ void SMTI::add_dummy(int num_dummy) {
   }
   _size += num_dummy;
   _num_dummies += num_dummy;
+  _grp.reset();
 }
 
 void SMTI::remove_dummy(int num_dummy) {
@@ -185,11 +348,13 @@ void SMTI::remove_dummy(int num_dummy) {
   }
   _size -= num_dummy;
   _num_dummies -= num_dummy;
+  _grp.reset();
 }
 
 void SMTI::remove_pair(int left, int right) {
   _ones.at(left).remove_preference(right);
   _twos.at(right).remove_preference(left);
+  _grp.reset();
 }
 
 
@@ -3,31 +3,49 @@
 
 #include <CoinDenseVector.hpp>
 #include <CoinPackedMatrix.hpp>
-#include <OsiSymSolverInterface.hpp>
 #include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
 #include <list>
+#include <memory>
 #include <random>
+#include <set>
+#include <stdexcept>
 #include <string>
 #include <unordered_map>
 
-// The type for our variable storage.
 #include <map>
-typedef std::map<int, std::map<int, int>> VarMap;
 
 #include "Agent.h"
+#include "IP_Backend.h"
+#include "IdMap.h"
 #include "matching.h"
 
+class GRP_Scores;
+class InstanceGenerator;
+
 // We use a tuple to convert variable subscripts to numbers according to DIMACS
-// format, which means we need to hash tuples of two integers.
+// format, which means we need to hash tuples of two integers. Both are packed
+// into 64 bits, so distinct tuples never collide whatever the size of the IDs.
 namespace std {
   template <>
   struct hash<std::tuple<int, int>> {
     size_t operator()(std::tuple<int, int> const& tt) const {
-      return std::get<0>(tt) * 5000 + std::get<1>(tt);
+      return (uint64_t(uint32_t(std::get<0>(tt))) << 32) | uint32_t(std::get<1>(tt));
     }
   };
 } // namespace std
 
+/**
+ * Thrown when building an encoding or IP model would take the memory used by
+ * an instance over the budget set with SMTI::memory_budget().
+ */
+class MemoryBudgetExceeded : public std::runtime_error {
+  public:
+    using std::runtime_error::runtime_error;
+};
 
 
 
@@ -39,11 +57,35 @@ class SMTI {
      */
     explicit SMTI(std::string filename);
 
+    /**
+     * Construct an instance from a file, reading it with the given number
+     * of threads (or one per core if threads is 0). The result is the same
+     * as when reading with one thread.
+     */
+    SMTI(std::string filename, int threads);
+
     /**
      * Construct an instance using the given parameters.
      */
     SMTI(int size, int pref_length, float tie_density, std::mt19937 & generator);
 
+    /**
+     * Construct a random instance like the constructor above, but where
+     * every agent draws from its own stream derived from seed. Each
+     * preference list is sampled in time linear in its length, agents are
+     * built with the given number of threads (or one per core if threads is
+     * 0), and the instance is the same for any number of threads.
+     * InstanceGenerator writes the same instance straight to a file.
+     */
+    SMTI(int size, int pref_length, float tie_density, uint64_t seed, int threads = 1);
+
+    /**
+     * Construct the instance from the given generator, which may describe
+     * any of its families of instances, with the given number of threads
+     * (or one per core if threads is 0).
+     */
+    explicit SMTI(const InstanceGenerator & generator, int threads = 1);
+
     /**
      * Construct an instance given two sets of preference lists.
      */
@@ -57,8 +99,97 @@ class SMTI {
     /**
      * Construct an instance from a file containing scores of Globally Ranked Pairs.
      * param threshold Assume any scores below this threshold
+     * param quantum If positive, scores in the same multiple of quantum are
+     * tied, e.g. 1 to tie scores with the same integer part.
+     */
+    static SMTI create_from_GRP(std::string filename, int threshold=0, float quantum=0);
+
+    /**
+     * As create_from_GRP(), but from a file giving the number of rows and
+     * columns on the first two lines, followed by one line per acceptable
+     * pair of the form "row col score". Pairs not in the file are not
+     * acceptable.
      */
-    static SMTI create_from_GRP(std::string filename, int threshold=0);
+    static SMTI create_from_sparse_GRP(std::string filename, int threshold=0, float quantum=0);
+
+    /**
+     * Whether the instance was created from Globally Ranked Pairs and has
+     * not been changed since, so that GRP_forced_pairs() and solve_GRP() can
+     * use the global order of pairs.
+     */
+    bool is_GRP() const { return bool(_grp); }
+
+    /**
+     * The pairs that are in every stable matching, found in linear time
+     * from the global order of pairs, as described in
+     * GRP_Scores::forced_pairs(). If no pairs that share an agent are tied,
+     * this is the only stable matching. Throws std::logic_error if
+     * is_GRP() is false.
+     */
+    Matching GRP_forced_pairs() const;
+
+    /**
+     * Find a largest stable matching of an instance with Globally Ranked
+     * Pairs, by taking GRP_forced_pairs() and solving the components of
+     * what is left of the instance with solve_components(). Instances that
+     * are not GRP are solved with IP_Model directly.
+     */
+    Matching solve_GRP() const;
+
+    class IP_Model;
+
+    /**
+     * Split the instance into the connected components of its
+     * acceptability graph, in time linear in the size of the preference
+     * lists. Each component is an instance of its own, with the same agent
+     * IDs, that can be encoded or solved independently. Agents that rank no
+     * one and are ranked by no one are in no component. Components are in
+     * order of their smallest agent on the left.
+     */
+    std::vector<SMTI> components() const;
+
+    /**
+     * Find a largest stable matching by solving each of components() with
+     * IP_Model, using the given number of threads (or one per core if
+     * threads is 0), and joining the results. configure, if given, is
+     * called on the model for each component before solving, e.g. to set
+     * the backend or options. Returns an empty matching if any component is
+     * not solved to optimality.
+     */
+    Matching solve_components(int threads = 1, const std::function<void(IP_Model &)> & configure = nullptr) const;
+
+    /**
+     * Write this instance in the binary format described in InstanceView.h,
+     * which can be read back with load_binary() or opened directly with
+     * InstanceView. Throws std::system_error if the file cannot be written.
+     */
+    void save_binary(const std::string & filename) const;
+
+    /**
+     * Read an instance written by save_binary(). Throws
+     * std::invalid_argument if the file is not a valid binary instance.
+     */
+    static SMTI load_binary(const std::string & filename);
+
+    /**
+     * Read an instance in the same text format as SMTI(filename), except
+     * that agents may be identified by any labels not containing blanks or
+     * any of ":[]()", such as names or large numbers. Each side numbers
+     * its agents 1, 2, ... in order of first appearance, and
+     * left_labels() and right_labels() translate between the two. Throws
+     * std::invalid_argument if an agent is given twice, or is ranked but
+     * not given.
+     */
+    static SMTI load_labelled(const std::string & filename);
+
+    /**
+     * Whether the instance came from load_labelled(), in which case
+     * left_labels() and right_labels() map the IDs of its agents to and
+     * from their labels. Dummy agents have no label.
+     */
+    bool has_labels() const { return bool(_left_labels); }
+    const IdMap<std::string> & left_labels() const { return *_left_labels; }
+    const IdMap<std::string> & right_labels() const { return *_right_labels; }
 
     /**
      * Return a string representation of this instance.
@@ -164,30 +295,194 @@ class SMTI {
      */
     std::string encodeMZN(bool optimise=false);
 
+    /**
+     * Find a stable matching by breaking all ties at random and running the
+     * Gale-Shapley algorithm, with agents on the left proposing. The result
+     * is always stable, but is not necessarily of largest size.
+     */
+    Matching gale_shapley(std::mt19937 & generator) const;
+
+    /**
+     * What is wrong with a matching, as found by check_stability().
+     * blocking_pairs Acceptable pairs in which both agents strictly prefer
+     * each other to their partners (or have none).
+     * unacceptable_pairs Pairs that are not acceptable to both agents, or
+     * name an agent not in the instance.
+     * left_over_capacity, right_over_capacity Agents in more than one
+     * pair. Only the first of their pairs is used for the other checks.
+     * left_unmatched, right_unmatched Agents without a partner although
+     * some agent finds them acceptable. These do not make the matching
+     * unstable on their own, but show where it could be larger.
+     */
+    struct StabilityReport {
+      Matching blocking_pairs;
+      Matching unacceptable_pairs;
+      std::vector<int> left_over_capacity;
+      std::vector<int> right_over_capacity;
+      std::vector<int> left_unmatched;
+      std::vector<int> right_unmatched;
+
+      bool stable() const {
+        return blocking_pairs.empty() && unacceptable_pairs.empty() &&
+               left_over_capacity.empty() && right_over_capacity.empty();
+      }
+    };
+
+    /**
+     * Check a matching against this instance without solving anything, in
+     * time linear in the size of the preference lists. Agents are listed in
+     * order of ID, and blocking pairs in order of the agent on the left.
+     */
+    StabilityReport check_stability(const Matching & matching) const;
+
+    /**
+     * Bytes held by the parts of an instance, estimated from the sizes and
+     * capacities of its containers.
+     * preferences The agents and their preference lists.
+     * variable_maps The maps from agents and ranks to SAT variables.
+     * encoding The largest buffer used by the most recent encoding.
+     */
+    struct MemoryUsage {
+      size_t preferences = 0;
+      size_t variable_maps = 0;
+      size_t encoding = 0;
+
+      size_t total() const { return preferences + variable_maps + encoding; }
+    };
+
+    MemoryUsage memory_usage() const;
+
+    /**
+     * Make encodings, and IP models built from this instance, throw
+     * MemoryBudgetExceeded as soon as they would take the memory used by
+     * the instance and the encoding or model over the given number of
+     * bytes, rather than running until the process is killed. 0, the
+     * default, means no limit. Copies of the instance keep the budget.
+     */
+    void memory_budget(size_t bytes) { _memory_budget = bytes; }
+    size_t memory_budget() const { return _memory_budget; }
+
 
 // IP details
 
     /**
      * Formulates the problem as an IP optimisation problem, and solves it
-     * using symphony.
+     * using Symphony, or any other solver available through IP_Backend.
      */
     class IP_Model {
       public:
         IP_Model(const SMTI * parent) : _parent(parent), _built(false), _merge(true),
-                                        _col_ub(nullptr), _col_lb(nullptr) { }
+                                        _lazy(false), _infeasible(false),
+                                        _heuristic_start(false), _backend_name("symphony") { }
+
+        /**
+         * How a solve finished.
+         * Optimal: The matching is a largest stable matching.
+         * Infeasible: No stable matching satisfies the forced and avoided
+         * pairs.
+         * Limit: A time or node limit was reached, or the gap limit was met.
+         * Cancelled: The cancel token was set.
+         * Failed: The solver stopped for any other reason.
+         */
+        enum Status { Optimal, Infeasible, Limit, Cancelled, Failed };
 
-        ~IP_Model();
+        /**
+         * The outcome of a solve. The matching is the largest stable matching
+         * found, even if it is not known to be optimal, and bound is an upper
+         * bound on the size of any stable matching satisfying the forced and
+         * avoided pairs.
+         */
+        struct Result {
+          Matching matching;
+          Status status = Failed;
+          double bound = 0;
+          int nodes = 0;
+          double seconds = 0;
+        };
 
         /**
-         * Find a stable matching of largest size.
+         * Find a stable matching of largest size. Returns an empty matching
+         * if no optimal matching was found.
          */
         Matching solve();
 
+        /**
+         * Find a stable matching of largest size, and report on how the
+         * search went. Unlike solve(), this also returns the best matching
+         * found when stopped early by a limit or cancellation.
+         */
+        Result solve_detailed();
+
+        /**
+         * An upper bound on the size of a stable matching satisfying the
+         * forced and avoided pairs, from the LP relaxation of the model.
+         * Returns -1 if the relaxation is infeasible. When adding
+         * constraints lazily, only the constraints added so far are used,
+         * so the bound is weaker but still valid.
+         */
+        double lp_bound();
+
+        /**
+         * Returns false if the LP relaxation proves that no stable matching
+         * of the given size exists. A return of true is no guarantee that
+         * one does.
+         */
+        bool may_achieve(int size);
+
+        /**
+         * Find pairs that are in no stable matching of size at least target,
+         * using the reduced costs of the LP relaxation, and avoid them in
+         * later solves. Typically target is the size of a known stable
+         * matching, in which case these pairs are in no largest stable
+         * matching either. Nothing is fixed if target is larger than
+         * lp_bound(), or if the backend does not give reduced costs.
+         *
+         * The pairs are returned so that they can also be removed from the
+         * instance with SMTI::remove_pair(). Note that removing a pair
+         * changes which matchings are stable, so the result should only be
+         * used this way if that is intended.
+         */
+        Matching reduced_cost_fixing(int target);
+
+        /**
+         * Write the current model, including forced and avoided pairs, in
+         * MPS format. Column x_l_r is the pair of left agent l and right
+         * agent r. When adding constraints lazily, only the constraints
+         * added so far are written.
+         */
+        void write_mps(const std::string & filename);
+
+        /**
+         * Write the current model in LP format, as for write_mps().
+         */
+        void write_lp(const std::string & filename);
+
+        /**
+         * Keep built models in the given directory. When the model is
+         * first needed, it is read from this directory if the same
+         * instance was built with the same settings of merge() and lazy()
+         * before, and written there otherwise. Files are in the byte order
+         * of the machine, so the directory should not be shared between
+         * machines of different architectures.
+         */
+        void cache_directory(const std::string & directory) { _cache_directory = directory; };
+
         /**
          * Finds all stable matchings.
          */
         std::list<Matching> find_all_stable_matchings();
 
+        /**
+         * Finds all stable matchings, using the given number of threads (or
+         * one per core if threads is 0). The search is split into disjoint
+         * parts by forcing each partner of some agents, or forcing them to
+         * be unmatched, and each part is enumerated with its own IP_Model.
+         * The settings, forced and avoided pairs of this model are used, but
+         * this model itself is not changed. The order of the result is the
+         * same for any number of threads.
+         */
+        std::list<Matching> find_all_stable_matchings(int threads);
+
         /**
          * Should merged stability constraints be used when building?
          * See Section 6.1 of https://doi.org/10.1016/j.ejor.2019.03.017
@@ -195,7 +490,76 @@ class SMTI {
         void merge(bool to_merge) { _merge = to_merge; };
 
         /**
-         * Force the pairs in forced to be in the matching.
+         * Should stability constraints be added lazily? If so, the model
+         * starts with the capacity constraints and the stability constraints
+         * for each first choice. After each solve, the stability constraints
+         * that are violated (i.e., blocking pairs) are added and the model
+         * is solved again, until the solution is stable. Works with either
+         * setting of merge(). Must be set before the first call to solve().
+         */
+        void lazy(bool to_lazy) { _lazy = to_lazy; };
+
+        /**
+         * Give the solver a stable matching to start from. The matching is
+         * passed to the solver as an incumbent, along with its size as an
+         * objective cutoff, whenever it satisfies all forced and avoided
+         * pairs. It is also returned if the solver proves that nothing
+         * larger exists.
+         */
+        void warm_start(const Matching & start) { _start = start; };
+
+        /**
+         * If true, and no matching was given to warm_start(), find a
+         * starting matching with SMTI::gale_shapley() before the first solve.
+         * The largest of a few attempts with different tie-breaking is used.
+         */
+        void heuristic_start(bool use_heuristic) { _heuristic_start = use_heuristic; };
+
+        /**
+         * Choose the solver to use, by a name registered with IP_Backend.
+         * Defaults to "symphony". Throws std::invalid_argument for unknown
+         * names.
+         */
+        void backend(const std::string & name);
+
+        /**
+         * Set threads, time limit, node limit and gap for the solver. The
+         * time limit covers the whole of a call to solve(), including the
+         * repeated solves when adding constraints lazily.
+         */
+        void options(const IP_Options & options) { _options = options; };
+
+        /**
+         * The number of columns (variables) and rows (constraints) in the
+         * model, which are 0 until it is first built. With lazy
+         * constraints, only the rows added so far are counted.
+         */
+        int num_cols() const { return _col_left.size(); }
+        int num_rows() const { return _row_lb.size(); }
+
+        /**
+         * Bytes held by the arrays of the model, not counting any copy
+         * loaded into the solver.
+         */
+        size_t memory_usage() const;
+
+        /**
+         * Call the given function with the incumbent, bound and node count
+         * as the solve progresses (as often as the backend allows) and once
+         * more when it finishes.
+         */
+        void progress(std::function<void(const IP_Progress &)> callback) { _progress = callback; };
+
+        /**
+         * Stop solving, and return the best matching found so far, once the
+         * given token is cancelled.
+         */
+        void cancel_token(const CancelToken & token) { _cancel = token; };
+
+        /**
+         * Force the pairs in forced to be in the matching. This is applied
+         * as bounds on the variables, so any other pair that contains one of
+         * the same agents is also excluded.
          */
         void force(const Matching & forced);
 
@@ -213,6 +577,14 @@ class SMTI {
          */
         void avoid_matching(const Matching & avoid);
 
+        /**
+         * Undo all calls to force() and avoid(), so that the same model can
+         * be reused for a different set of forced and avoided pairs without
+         * being rebuilt. Matchings given to avoid_matching() are still
+         * avoided.
+         */
+        void clear_forces_avoids();
+
       private:
         /**
         * Adds stability constraints to the model. One constraints is generated
@@ -226,14 +598,162 @@ class SMTI {
         */
         void add_merged_constraints();
 
+        /**
+         * Adds the single stability constraint for the pair in the given
+         * column.
+         */
+        void add_single_constraint(int col);
+
+        /**
+         * Adds the merged stability constraint for the tie group at the given
+         * rank in the preferences of the left agent with the given index.
+         */
+        void add_merged_constraint(int left, int rank);
+
+        /**
+         * Finishes the row whose entries were pushed since the previous row.
+         */
+        void end_row(double lower, double upper);
+
+        /**
+         * The column for the pair (left, right), given by agent IDs, or -1 if
+         * there is no such column.
+         */
+        int column(int left, int right) const;
+
+        /**
+         * Assigns dense indices to agents and columns to pairs, and finds
+         * the tie groups in terms of these.
+         */
+        void build_index();
+
+        /**
+         * Adds the initial stability constraints when using lazy constraints.
+         */
+        void add_seed_constraints();
+
+        /**
+         * Adds the stability constraints violated by the given matching, and
+         * returns how many were added.
+         */
+        int add_violated_constraints(const Matching & matching);
+
+        /**
+         * Solve the model as it currently stands.
+         */
+        Result solve_current();
+
+        /**
+         * Seconds since the current call to solve_detailed() started.
+         */
+        double elapsed() const;
+
+        /**
+         * Fill start with the column values for _start, if _start is a
+         * feasible solution of the current model.
+         */
+        bool start_solution(std::vector<double> & start) const;
+
+        /**
+         * Build the base model, or read it from the cache, if not yet done.
+         */
+        void build_model();
+
+        /**
+         * Build the model if needed, and apply new forced and avoided pairs.
+         */
+        void prepare();
+
+        /**
+         * Give column names to the solver, for writing the model.
+         */
+        void name_columns();
+
+        /**
+         * A hash of the instance and of the settings used to build.
+         */
+        uint64_t cache_key() const;
+
+        /**
+         * The name of the cache file for the given key.
+         */
+        std::string cache_file(uint64_t key) const;
+
+        /**
+         * Read the built model from the cache, if it is there.
+         */
+        bool load_cache();
+
+        /**
+         * Whether the arrays of the model fit together: their lengths
+         * agree, offsets are monotone and every index is in range. Used to
+         * reject cache files that pass the checksum but were written by a
+         * different build.
+         */
+        bool consistent_model() const;
+
+        /**
+         * Write the built model to the cache.
+         */
+        void save_cache();
+
+        /**
+         * Take a copy of the built base model of base, which must be of the
+         * same instance with the same settings, instead of building it.
+         */
+        void copy_model(const IP_Model & base);
+
+        /**
+         * Call visit on each array holding the built model, in a fixed
+         * order. model is either *this or a const reference to it.
+         */
+        template <typename Model, typename Function>
+        static void visit_model(Model & model, Function visit);
+
+        /**
+         * Load the model into a fresh instance of the named backend, with
+         * or without integrality.
+         */
+        void load_problem(const std::string & backend_name, bool integer);
+
+        /**
+         * Solve the LP relaxation of the model, and return whether it was
+         * solved to optimality.
+         */
+        bool solve_relaxation();
+
         void build_base();
 
+        /**
+         * Throw MemoryBudgetExceeded, after freeing the model, if a model
+         * of model_bytes and its instance are over the budget of the
+         * instance.
+         */
+        void check_memory_budget(size_t model_bytes);
+
+        /**
+         * A lower bound on memory_usage() once built, from the sizes of the
+         * preference lists alone, so that the budget can be checked before
+         * building.
+         */
+        size_t minimum_memory_usage() const;
+
         void build_avoids_forces();
 
         const SMTI * _parent;
 
         bool _built;
         bool _merge;
+        bool _lazy;
+        // Set if the forced and avoided pairs cannot all be satisfied.
+        bool _infeasible;
+        bool _heuristic_start;
+
+        // Number of runs of the heuristic for a starting solution.
+        static constexpr int heuristic_attempts = 10;
+        // When enumerating in parallel, split until there are at least this
+        // many subproblems per thread, to balance the load.
+        static constexpr int subproblems_per_thread = 4;
 
         // For the below 6 variables, if the name starts with "_to_" then the
         // correspond variable stores constraints that have not yet been added
@@ -245,17 +765,70 @@ class SMTI {
         Matching _avoided;
         std::list<Matching> _to_avoid_matchings;
         std::list<Matching> _avoided_matchings;
-
-        CoinPackedMatrix _constraints;
-        std::list<double> _lhs;
-        std::list<double> _rhs;
-        double* _col_ub;
-        double* _col_lb;
-        VarMap _lr;
-        OsiSymSolverInterface _solverInterface;
+        // The starting solution, if any.
+        Matching _start;
+
+        // Agents are indexed in order of their IDs. The columns of left
+        // agent i are _left_start[i] up to _left_start[i+1], in order of
+        // preference, and tie group g of left agent i ends (exclusive) at
+        // column _left_group_end[_left_group_offset[i] + g].
+        std::vector<int> _left_ids;
+        std::vector<int> _right_ids;
+        std::unordered_map<int, int> _left_index;
+        std::unordered_map<int, int> _right_index;
+        std::vector<int> _left_start;
+        std::vector<int> _left_group_offset;
+        std::vector<int> _left_group_end;
+        // Position p in the preferences of right agent j, for p from
+        // _right_start[j] up to _right_start[j+1], is column _right_cols[p]
+        // (-1 if the left agent does not find j acceptable), in tie group
+        // _right_rank[p] which ends at position _right_group_end[p].
+        std::vector<int> _right_start;
+        std::vector<int> _right_cols;
+        std::vector<int> _right_rank;
+        std::vector<int> _right_group_end;
+        // For each column, the indices of the agents, the rank of the right
+        // agent to the left one, and the position in the preferences of the
+        // right agent (-1 if the right agent does not find left acceptable).
+        std::vector<int> _col_left;
+        std::vector<int> _col_right;
+        std::vector<int> _col_left_rank;
+        std::vector<int> _col_right_pos;
+        // The constraint matrix, by rows.
+        std::vector<CoinBigIndex> _row_start;
+        std::vector<int> _row_index;
+        std::vector<double> _row_value;
+        std::vector<double> _row_lb;
+        std::vector<double> _row_ub;
+        std::vector<double> _col_lb;
+        std::vector<double> _col_ub;
+        // Stability constraints already in the model when adding them lazily,
+        // either by column or by tie group (indexed like _left_group_end).
+        std::vector<bool> _separated_pairs;
+        std::vector<bool> _separated_groups;
+        std::string _backend_name;
+        std::string _cache_directory;
+        IP_Options _options;
+        // The backend used for the most recent solve.
+        std::unique_ptr<IP_Backend> _backend;
+        std::function<void(const IP_Progress &)> _progress;
+        CancelToken _cancel;
+        std::chrono::steady_clock::time_point _solve_start;
+        // Set if the current solve was stopped by the callback given to the
+        // backend, to either Limit or Cancelled.
+        Status _interrupted;
+        // Whether _start was given to the solver in the current solve.
+        bool _start_used;
+        // Size of a largest matching if stability is ignored, or at least an
+        // upper bound on it.
+        int _size_bound;
     };
 
   private:
+    /**
+     * An empty instance, to be filled in by a loader.
+     */
+    SMTI();
 
     /**
      * Create the maps from IDs/positions in preference lists to variable
@@ -264,15 +837,40 @@ class SMTI {
      */
     void make_var_map();
 
+    /**
+     * Start an encoding, returning the bytes held by the instance if there
+     * is a memory budget (and 0 otherwise) to be passed to
+     * check_memory_budget().
+     */
+    size_t start_encoding();
+
+    /**
+     * Record the size of the given encoding buffer, and throw
+     * MemoryBudgetExceeded if it takes the instance over budget. The buffer
+     * is counted three times, as it is copied twice in building the string
+     * that the encoding returns.
+     */
+    void check_memory_budget(const char * phase, size_t base, std::stringstream & encoding);
+
     int _size;
     int _num_dummies;
     std::unordered_map<int, Agent> _ones;
     std::unordered_map<int, Agent> _twos;
     std::unordered_map<std::tuple<int,int>, int> _one_vars;
     std::unordered_map<std::tuple<int,int>, int> _two_vars;
+    // The scores this instance was built from, if it came from
+    // create_from_GRP() and has not been changed since.
+    std::shared_ptr<const GRP_Scores> _grp;
+    float _grp_threshold = 0;
+    // The labels of the agents, if the instance came from load_labelled().
+    std::shared_ptr<const IdMap<std::string>> _left_labels;
+    std::shared_ptr<const IdMap<std::string>> _right_labels;
+    size_t _memory_budget = 0;
+    size_t _encoding_bytes = 0;
 
     static constexpr float epsilon = 1e-6;
 
+  friend class GRP_Scores;
   friend class IP_Model;
 };
 
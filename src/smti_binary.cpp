@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+
+#include "InstanceView.h"
+#include "Stats.h"
+#include "smti.h"
+
+namespace {
+  // Append the given values to buffer, padded to a multiple of 8 bytes.
+  template <typename T>
+  void append(std::vector<char> & buffer, const std::vector<T> & values) {
+    size_t bytes = values.size() * sizeof(T);
+    size_t start = buffer.size();
+    buffer.resize(start + (bytes + 7) / 8 * 8, 0);
+    if (bytes > 0) {
+      std::memcpy(buffer.data() + start, values.data(), bytes);
+    }
+  }
+
+  std::vector<int> sorted_ids(const std::unordered_map<int, Agent> & agents) {
+    std::vector<int> ids;
+    ids.reserve(agents.size());
+    for(auto & [id, agent]: agents) {
+      ids.push_back(id);
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+  }
+} // namespace
+
+SMTI::SMTI() : _size(0), _num_dummies(0) { }
+
+void SMTI::save_binary(const std::string & filename) const {
+  SMTI_TIME("save_binary");
+  std::vector<int> left_ids = sorted_ids(_ones);
+  std::vector<int> right_ids = sorted_ids(_twos);
+  std::vector<int32_t> ids(left_ids.begin(), left_ids.end());
+  ids.insert(ids.end(), right_ids.begin(), right_ids.end());
+  std::vector<int64_t> agent_groups;
+  std::vector<int64_t> group_prefs;
+  std::vector<int32_t> prefs;
+  agent_groups.reserve(ids.size() + 1);
+  for(size_t index = 0; index < ids.size(); ++index) {
+    const Agent & agent = (index < left_ids.size()) ? _ones.at(ids[index]) : _twos.at(ids[index]);
+    agent_groups.push_back(group_prefs.size());
+    for(const std::vector<int> & tie: agent.preferences()) {
+      group_prefs.push_back(prefs.size());
+      prefs.insert(prefs.end(), tie.begin(), tie.end());
+    }
+  }
+  agent_groups.push_back(group_prefs.size());
+  group_prefs.push_back(prefs.size());
+
+  BinaryInstanceHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::copy(BinaryInstanceHeader::expected_magic, BinaryInstanceHeader::expected_magic + 8, header.magic);
+  header.version = BinaryInstanceHeader::current_version;
+  header.header_size = sizeof(header);
+  header.size = _size;
+  header.num_dummies = _num_dummies;
+  header.num_left = left_ids.size();
+  header.num_right = right_ids.size();
+  header.num_groups = group_prefs.size() - 1;
+  header.num_prefs = prefs.size();
+
+  std::vector<char> payload;
+  payload.reserve(header.payload_size());
+  append(payload, ids);
+  append(payload, agent_groups);
+  append(payload, group_prefs);
+  append(payload, prefs);
+  header.checksum = BinaryInstanceHeader::compute_checksum(payload.data(), payload.size());
+
+  std::ofstream out(filename, std::ios::binary);
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out.write(payload.data(), payload.size());
+  if (!out) {
+    throw std::system_error(errno, std::generic_category(), "Could not write " + filename);
+  }
+}
+
+SMTI SMTI::load_binary(const std::string & filename) {
+  SMTI_TIME("load_binary");
+  InstanceView view(filename);
+  if (!view.verify()) {
+    throw std::invalid_argument(filename + " is corrupt");
+  }
+  SMTI instance;
+  instance._size = view.header().size;
+  instance._num_dummies = view.header().num_dummies;
+  instance._ones.reserve(view.num_agents_left());
+  instance._twos.reserve(view.num_agents_right());
+  for(size_t index = 0; index < view.num_agents_left(); ++index) {
+    std::vector<std::vector<int>> preferences(view.num_groups_left(index));
+    for(size_t rank = 0; rank < preferences.size(); ++rank) {
+      InstanceView::Range tie = view.group_left(index, rank);
+      preferences[rank].assign(tie.begin(), tie.end());
+    }
+    int id = view.left_id(index);
+    instance._ones.emplace(id, Agent(id, std::move(preferences)));
+  }
+  for(size_t index = 0; index < view.num_agents_right(); ++index) {
+    std::vector<std::vector<int>> preferences(view.num_groups_right(index));
+    for(size_t rank = 0; rank < preferences.size(); ++rank) {
+      InstanceView::Range tie = view.group_right(index, rank);
+      preferences[rank].assign(tie.begin(), tie.end());
+    }
+    int id = view.right_id(index);
+    instance._twos.emplace(id, Agent(id, std::move(preferences)));
+  }
+  return instance;
+}
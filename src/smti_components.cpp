@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <numeric>
+#include <thread>
+
+#include "Stats.h"
+#include "smti.h"
+
+namespace {
+  // Union-find over the agents of both sides, by index.
+  int find_root(std::vector<int> & parent, int index) {
+    while (parent[index] != index) {
+      parent[index] = parent[parent[index]];
+      index = parent[index];
+    }
+    return index;
+  }
+} // namespace
+
+std::vector<SMTI> SMTI::components() const {
+  SMTI_TIME("components");
+  // Index the agents in order of ID, left then right, so that the
+  // components come out in the same order however the maps are laid out.
+  std::vector<int> left_ids, right_ids;
+  for(auto & [id, agent]: _ones) {
+    left_ids.push_back(id);
+  }
+  for(auto & [id, agent]: _twos) {
+    right_ids.push_back(id);
+  }
+  std::sort(left_ids.begin(), left_ids.end());
+  std::sort(right_ids.begin(), right_ids.end());
+  std::unordered_map<int, int> left_index, right_index;
+  for(size_t i = 0; i < left_ids.size(); ++i) {
+    left_index[left_ids[i]] = i;
+  }
+  for(size_t j = 0; j < right_ids.size(); ++j) {
+    right_index[right_ids[j]] = left_ids.size() + j;
+  }
+
+  // Join each agent with everyone it ranks. Lists need not be symmetric, so
+  // both sides are read.
+  std::vector<int> parent(left_ids.size() + right_ids.size());
+  std::iota(parent.begin(), parent.end(), 0);
+  for(auto [agents, own, other]: {std::make_tuple(&_ones, &left_index, &right_index),
+                                  std::make_tuple(&_twos, &right_index, &left_index)}) {
+    for(auto & [id, agent]: *agents) {
+      int root = find_root(parent, own->at(id));
+      for(const std::vector<int> & tie: agent.preferences()) {
+        for(int pref: tie) {
+          auto partner = other->find(pref);
+          if (partner == other->end()) {
+            continue;
+          }
+          int partner_root = find_root(parent, partner->second);
+          if (partner_root != root) {
+            // Keep the smaller index as the root, so that roots are in
+            // order of first agent.
+            parent[std::max(root, partner_root)] = std::min(root, partner_root);
+            root = std::min(root, partner_root);
+          }
+        }
+      }
+    }
+  }
+
+  std::vector<int> size(parent.size(), 0);
+  for(size_t index = 0; index < parent.size(); ++index) {
+    size[find_root(parent, index)]++;
+  }
+  // Number the components in order of their roots, skipping agents that
+  // rank no one and are ranked by no one.
+  std::vector<int> component(parent.size(), -1);
+  int count = 0;
+  for(size_t index = 0; index < parent.size(); ++index) {
+    if ((parent[index] == (int)index) && (size[index] > 1)) {
+      component[index] = count++;
+    }
+  }
+  std::vector<SMTI> result;
+  result.reserve(count);
+  for(int part = 0; part < count; ++part) {
+    result.push_back(SMTI());
+    result.back()._memory_budget = _memory_budget;
+    result.back()._left_labels = _left_labels;
+    result.back()._right_labels = _right_labels;
+  }
+  for(size_t index = 0; index < parent.size(); ++index) {
+    int part = component[find_root(parent, index)];
+    if (part == -1) {
+      continue;
+    }
+    if (index < left_ids.size()) {
+      int id = left_ids[index];
+      result[part]._ones.emplace(id, _ones.at(id));
+      result[part]._size++;
+    } else {
+      int id = right_ids[index - left_ids.size()];
+      result[part]._twos.emplace(id, _twos.at(id));
+    }
+  }
+  return result;
+}
+
+Matching SMTI::solve_components(int threads, const std::function<void(IP_Model &)> & configure) const {
+  if (threads <= 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  std::vector<SMTI> parts = components();
+  // Hand out the largest components first, so that one is not left running
+  // alone at the end.
+  std::vector<size_t> order(parts.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&parts](size_t a, size_t b) {
+    return parts[a].num_agents_left() + parts[a].num_agents_right() >
+           parts[b].num_agents_left() + parts[b].num_agents_right();
+  });
+  std::vector<Matching> found(parts.size());
+  std::vector<std::exception_ptr> errors(parts.size());
+  std::atomic<size_t> next(0);
+  std::atomic<bool> failed(false);
+  auto work = [&]() {
+    for(size_t index = next++; index < parts.size(); index = next++) {
+      size_t part = order[index];
+      try {
+        IP_Model model(&parts[part]);
+        if (configure) {
+          configure(model);
+        }
+        IP_Model::Result solved = model.solve_detailed();
+        if (solved.status == IP_Model::Optimal) {
+          found[part] = std::move(solved.matching);
+        } else {
+          failed = true;
+        }
+      } catch (...) {
+        errors[part] = std::current_exception();
+      }
+    }
+  };
+  std::vector<std::thread> pool;
+  for(int thread = 1; thread < std::min<int>(threads, parts.size()); ++thread) {
+    pool.emplace_back(work);
+  }
+  work();
+  for(std::thread & thread: pool) {
+    thread.join();
+  }
+  for(std::exception_ptr & error: errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+  Matching matching;
+  if (failed) {
+    // As with IP_Model::solve(), no matching unless all are optimal.
+    return matching;
+  }
+  for(Matching & part: found) {
+    matching.splice(matching.end(), part);
+  }
+  return matching;
+}
@@ -1,8 +1,11 @@
+#include "Stats.h"
 #include "smti.h"
 
 std::string SMTI::encodeSAT() {
+  SMTI_TIME("encodeSAT");
   make_var_map();
   std::stringstream ss;
+  size_t base = start_encoding();
   int num_clauses = 0;
   // Clause 1
   for (auto & [key, one]: _ones) {
@@ -37,6 +40,7 @@ std::string SMTI::encodeSAT() {
     }
   }
   for (auto & [key, one]: _ones) {
+    check_memory_budget("encodeSAT", base, ss);
     for (auto two_id: one.prefs()) {
       Agent &two = _twos.at(two_id);
       int p = one.position_of(two);
@@ -86,13 +90,17 @@ std::string SMTI::encodeSAT() {
   std::stringstream start;
   start << "p cnf " << (_one_vars.size() + _two_vars.size()) << " " << num_clauses;
   start << std::endl << ss.str();
+  check_memory_budget("encodeSAT", base, start);
   return start.str();
 }
 
 std::string SMTI::encodeMZN(bool optimise) {
+  SMTI_TIME("encodeMZN");
   std::stringstream ss;
+  size_t base = start_encoding();
   std::vector<std::string> vars;
   for(auto & [key, one]: _ones) {
+    check_memory_budget("encodeMZN", base, ss);
     for(auto & [twokey, two]: _twos) {
       if (one.is_compatible(two)) {
         std::string name = "x" + std::to_string(one.id()) + "_" + std::to_string(two.id());
@@ -140,6 +148,7 @@ std::string SMTI::encodeMZN(bool optimise) {
   }
   // Stability constraints
   for(auto & [key, one]: _ones) {
+    check_memory_budget("encodeMZN", base, ss);
     for(int two_id: one.prefs()) {
       Agent & two = _twos.at(two_id);
       ss << "constraint 1 - (";
@@ -200,12 +209,15 @@ std::string SMTI::encodeMZN(bool optimise) {
   //  first = false;
   //}
   //ss << "];" << std::endl;
+  check_memory_budget("encodeMZN", base, ss);
   return ss.str();
 }
 
 std::string SMTI::encodeWPMaxSAT() {
+  SMTI_TIME("encodeWPMaxSAT");
   make_var_map();
   std::stringstream ss;
+  size_t base = start_encoding();
   int num_clauses = 0;
   int top_weight = 500;
   // Clause 1
@@ -247,6 +259,7 @@ std::string SMTI::encodeWPMaxSAT() {
     }
   }
   for (auto & [key, one]: _ones) {
+    check_memory_budget("encodeWPMaxSAT", base, ss);
     for (auto two_id: one.prefs()) {
       Agent &two = _twos.at(two_id);
       int p = one.position_of(two);
@@ -303,12 +316,15 @@ std::string SMTI::encodeWPMaxSAT() {
   start << "p wcnf " << (_one_vars.size() + _two_vars.size()) << " " << num_clauses;
   start << " " << top_weight;
   start << std::endl << ss.str();
+  check_memory_budget("encodeWPMaxSAT", base, start);
   return start.str();
 }
 
 std::string SMTI::encodePBO() {
+  SMTI_TIME("encodePBO");
   make_var_map();
   std::stringstream ss;
+  size_t base = start_encoding();
   int num_clauses = 0;
   // Clause 1
   for (auto & [key, one]: _ones) {
@@ -337,6 +353,7 @@ std::string SMTI::encodePBO() {
     }
   }
   for (auto & [key, one]: _ones) {
+    check_memory_budget("encodePBO", base, ss);
     for (auto two_id: one.prefs()) {
       Agent &two = _twos.at(two_id);
       int p = one.position_of(two);
@@ -413,16 +430,19 @@ std::string SMTI::encodePBO() {
   }
   start << " ;" << std::endl;
   start << ss.str();
+  check_memory_budget("encodePBO", base, start);
   return start.str();
 }
 
 std::string SMTI::encodePBO2(bool merged) {
+  SMTI_TIME("encodePBO2");
   // Count number of constraints and variables
   int cons = 0;
   int nvars = 0;
 
   // We build the encoding in ss
   std::stringstream ss;
+  size_t base = start_encoding();
 
   // var_map[one.id()][two.id()] is the integer component of the variable that
   // represents matching one and two.
@@ -470,6 +490,7 @@ std::string SMTI::encodePBO2(bool merged) {
   // Stability constraints
   if (!merged) {
     for(auto & [key, one]: _ones) {
+      check_memory_budget("encodePBO2", base, ss);
       for(int two_id: one.prefs()) {
         const Agent & two = agent_right(two_id);
         // 1 - first_sum <= second_sum
@@ -512,6 +533,7 @@ std::string SMTI::encodePBO2(bool merged) {
 
 
     for(auto & [key, one]: _ones) {
+      check_memory_budget("encodePBO2", base, ss);
       for(unsigned int r = 0; r < one.preferences().size(); ++r) {
         one_filled_at_rank[one.id()][r] = ++nvars;
         // Make constraint that ensures these variables are accurate
@@ -622,11 +644,13 @@ std::string SMTI::encodePBO2(bool merged) {
   }
   start << " ;" << std::endl;
   start << ss.str();
+  check_memory_budget("encodePBO2", base, start);
   return start.str();
 }
 
 
 void SMTI::make_var_map() {
+  SMTI_TIME("make_var_map");
   _one_vars = std::unordered_map<std::tuple<int,int>, int>();
   _two_vars = std::unordered_map<std::tuple<int,int>, int>();
   int counter = 1;
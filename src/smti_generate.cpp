@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <thread>
+
+#include "InstanceGenerator.h"
+#include "smti.h"
+
+SMTI::SMTI(int size, int pref_length, float tie_density, uint64_t seed, int threads) :
+  SMTI(InstanceGenerator(size, pref_length, tie_density, seed), threads) { }
+
+SMTI::SMTI(const InstanceGenerator & generator, int threads) :
+  _size(generator.size()), _num_dummies(0) {
+  if (threads <= 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  int size = _size;
+  auto run = [threads](auto work) {
+    std::vector<std::thread> pool;
+    for(int thread = 1; thread < threads; ++thread) {
+      pool.emplace_back(work, thread);
+    }
+    work(0);
+    for(std::thread & thread: pool) {
+      thread.join();
+    }
+  };
+  auto first = [threads, size](int thread) { return 1 + (int)((int64_t)size * thread / threads); };
+
+  std::vector<std::vector<std::vector<int>>> one_prefs(size + 1);
+  run([&](int thread) {
+    for(int i = first(thread); i < first(thread + 1); ++i) {
+      one_prefs[i] = generator.left(i);
+    }
+  });
+
+  // Agents on the right find acceptable those that chose them, in order of
+  // ID before shuffling, so the result does not depend on the threads.
+  std::vector<int> count(size + 1, 0);
+  for(int i = 1; i <= size; ++i) {
+    for(const std::vector<int> & tie: one_prefs[i]) {
+      for(int pref: tie) {
+        count[pref] += 1;
+      }
+    }
+  }
+  std::vector<std::vector<int>> choosers(size + 1);
+  for(int j = 1; j <= size; ++j) {
+    choosers[j].reserve(count[j]);
+  }
+  for(int i = 1; i <= size; ++i) {
+    for(const std::vector<int> & tie: one_prefs[i]) {
+      for(int pref: tie) {
+        choosers[pref].push_back(i);
+      }
+    }
+  }
+
+  // The maps cannot be filled concurrently, so every agent gets a slot
+  // first, and the threads then fill in their own slots.
+  _ones.reserve(size);
+  _twos.reserve(size);
+  std::vector<Agent *> ones(size + 1);
+  std::vector<Agent *> twos(size + 1);
+  for(int i = 1; i <= size; ++i) {
+    ones[i] = &_ones.emplace(i, Agent(i, std::vector<std::vector<int>>())).first->second;
+    twos[i] = &_twos.emplace(i, Agent(i, std::vector<std::vector<int>>())).first->second;
+  }
+  run([&](int thread) {
+    for(int i = first(thread); i < first(thread + 1); ++i) {
+      *ones[i] = Agent(i, std::move(one_prefs[i]));
+      *twos[i] = Agent(i, generator.right(i, std::move(choosers[i])));
+    }
+  });
+}
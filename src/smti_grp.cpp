@@ -1,88 +1,41 @@
-#include <fstream>
-#include <sstream>
+#include <stdexcept>
 
+#include "GRP_Scores.h"
 #include "smti.h"
 
+SMTI SMTI::create_from_GRP(std::string filename, int threshold, float quantum) {
+  auto scores = std::make_shared<const GRP_Scores>(filename, false, quantum, threshold);
+  SMTI instance = scores->instance(threshold);
+  instance._grp = scores;
+  instance._grp_threshold = threshold;
+  return instance;
+}
 
-SMTI SMTI::create_from_GRP(std::string filename, int threshold) {
-  std::ifstream infile(filename);
-  std::string line;
-  getline(infile, line);
-  int nrows = std::stoi(line);
-
-  getline(infile, line);
-  int ncols = std::stoi(line);
-
-  std::vector<std::vector<std::pair<int, float>>> row_agents(nrows);
-  std::vector<std::vector<std::pair<int, float>>> col_agents(ncols);
-
-  for(int row = 0; row < nrows; ++row) {
-    // For each row
-    getline(infile, line);
-    std::stringstream prefstream(line);
-    int col = 0;
-    std::string token;
-    while (prefstream >> token) {
-      if (token.length() == 0) {
-        break;
-      }
-      float score = std::stof(token);
-      row_agents[row].push_back(std::make_pair(col, score));
-      col_agents[col].push_back(std::make_pair(row, score));
-      col += 1;
-    }
-  }
+SMTI SMTI::create_from_sparse_GRP(std::string filename, int threshold, float quantum) {
+  auto scores = std::make_shared<const GRP_Scores>(filename, true, quantum, threshold);
+  SMTI instance = scores->instance(threshold);
+  instance._grp = scores;
+  instance._grp_threshold = threshold;
+  return instance;
+}
 
-  // rows are _ones
-  std::vector<std::vector<std::vector<int>>> ones;
-  for(int row = 0; row < nrows; ++row) {
-    std::sort(row_agents[row].begin(), row_agents[row].end(),
-              [](const std::pair<int, float> & a, const std::pair<int, float> & b) { return a.second > b.second; });
-    std::vector<int> indices;
-    std::vector<std::vector<int>> preferences;
-    std::vector<int> this_pref;
-    float last_score = row_agents[row].front().second;
-    for(auto & [pref, score]: row_agents[row]) {
-      if (score < threshold) {
-        break;
-      }
-      if (last_score != score) {
-        preferences.push_back(std::move(this_pref));
-        this_pref = std::vector<int>();
-      }
-      this_pref.push_back(pref);
-      last_score = score;
-    }
-    if (! this_pref.empty()) {
-        preferences.push_back(std::move(this_pref));
-    }
-    ones.push_back(preferences);
+Matching SMTI::GRP_forced_pairs() const {
+  if (!_grp) {
+    throw std::logic_error("Instance does not have globally ranked pairs");
   }
+  return _grp->forced_pairs(_grp_threshold);
+}
 
-  // cols are _twos
-  std::vector<std::vector<std::vector<int>>> twos;
-  for(int col = 0; col < ncols; ++col) {
-    std::sort(col_agents[col].begin(), col_agents[col].end(),
-              [](const std::pair<int, float> & a, const std::pair<int, float> & b) { return a.second > b.second; });
-    std::vector<int> indices;
-    std::vector<std::vector<int>> preferences;
-    std::vector<int> this_pref;
-    float last_score = col_agents[col].front().second;
-    for(auto & [pref, score]: col_agents[col]) {
-      if (score < threshold) {
-        break;
-      }
-      if (last_score != score) {
-        preferences.push_back(std::move(this_pref));
-        this_pref = std::vector<int>();
-      }
-      this_pref.push_back(pref);
-      last_score = score;
-    }
-    if (! this_pref.empty()) {
-        preferences.push_back(std::move(this_pref));
-    }
-    twos.push_back(preferences);
+Matching SMTI::solve_GRP() const {
+  if (!_grp) {
+    IP_Model model(this);
+    return model.solve();
   }
-  return SMTI(ones, twos);
+  Matching matching = GRP_forced_pairs();
+  // Only agents with a pair left need the IP, and what is left usually
+  // falls apart into small components.
+  SMTI rest = _grp->instance(_grp_threshold, matching);
+  Matching solved = rest.solve_components();
+  matching.splice(matching.end(), solved);
+  return matching;
 }
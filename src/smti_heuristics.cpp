@@ -0,0 +1,68 @@
+/**
+ * Fast heuristics for finding stable matchings. These do not find optimal
+ * matchings, but are useful as starting points for exact methods.
+ */
+
+#include "smti.h"
+
+Matching SMTI::gale_shapley(std::mt19937 & generator) const {
+  // Break ties at random, giving each agent a strict preference list.
+  std::unordered_map<int, std::vector<int>> left_order;
+  for(auto & [key, one]: _ones) {
+    std::vector<int> & order = left_order[one.id()];
+    for(auto tie: one.preferences()) {
+      std::shuffle(tie.begin(), tie.end(), generator);
+      order.insert(order.end(), tie.begin(), tie.end());
+    }
+  }
+  std::unordered_map<int, std::unordered_map<int, int>> right_rank;
+  for(auto & [key, two]: _twos) {
+    std::unordered_map<int, int> & ranks = right_rank[two.id()];
+    int rank = 0;
+    for(auto tie: two.preferences()) {
+      std::shuffle(tie.begin(), tie.end(), generator);
+      for(int pref: tie) {
+        ranks[pref] = rank++;
+      }
+    }
+  }
+
+  // Agents on the left propose, in order of their (now strict) preferences.
+  std::unordered_map<int, size_t> next_proposal;
+  std::unordered_map<int, int> right_partner;
+  std::list<int> free;
+  for(auto & [key, one]: _ones) {
+    free.push_back(one.id());
+    next_proposal[one.id()] = 0;
+  }
+  while (!free.empty()) {
+    int proposer = free.front();
+    free.pop_front();
+    const std::vector<int> & order = left_order[proposer];
+    while (next_proposal[proposer] < order.size()) {
+      int two_id = order[next_proposal[proposer]++];
+      const std::unordered_map<int, int> & ranks = right_rank[two_id];
+      auto proposer_rank = ranks.find(proposer);
+      if (proposer_rank == ranks.end()) {
+        // Preference lists disagree about acceptability.
+        continue;
+      }
+      auto current = right_partner.find(two_id);
+      if (current == right_partner.end()) {
+        right_partner[two_id] = proposer;
+        break;
+      }
+      if (proposer_rank->second < ranks.at(current->second)) {
+        free.push_back(current->second);
+        current->second = proposer;
+        break;
+      }
+    }
+  }
+
+  Matching result;
+  for(auto [right, left]: right_partner) {
+    result.emplace_back(left, right);
+  }
+  return result;
+}
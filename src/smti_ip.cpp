@@ -1,105 +1,171 @@
+#include <CoinFinite.hpp>
 #include <CoinPackedMatrix.hpp>
-#include <CoinPackedVector.hpp>
-#include <OsiSymSolverParameters.hpp>
+#include <atomic>
+#include <cmath>
 #include <iterator>
+#include <limits>
+#include <thread>
+#include "Stats.h"
 #include "smti.h"
 
 //#define DEBUG_IP_MODEL
 
-SMTI::IP_Model::~IP_Model() {
-  if (_col_lb) {
-    delete[] _col_lb;
+void SMTI::IP_Model::end_row(double lower, double upper) {
+  _row_start.push_back(_row_index.size());
+  _row_lb.push_back(lower);
+  _row_ub.push_back(upper);
+}
+
+void SMTI::IP_Model::add_single_constraint(int col) {
+  int left = _col_left[col];
+  int right = _col_right[col];
+  // First sum, over the left agent's preferences at least as good as right.
+  // The column itself is in both sums.
+  int end = _left_group_end[_left_group_offset[left] + _col_left_rank[col]];
+  for(int other = _left_start[left]; other < end; ++other) {
+    _row_index.push_back(other);
+    _row_value.push_back((other == col) ? -2 : -1);
   }
-  if (_col_ub) {
-    delete[] _col_ub;
+  // Second sum
+  int pos_end = _right_group_end[_col_right_pos[col]];
+  for(int pos = _right_start[right]; pos < pos_end; ++pos) {
+    int other = _right_cols[pos];
+    if ((other >= 0) && (other != col)) {
+      _row_index.push_back(other);
+      _row_value.push_back(-1);
+    }
   }
+  // Want 1 - first_sum <= second sum
+  // 1 <= first_sum + second_sum
+  // -1 >= -first_sum - second_sum
+  end_row(-1.0 * COIN_DBL_MAX, -1);
 }
 
 void SMTI::IP_Model::add_single_constraints() {
   // Single stability constraints
-  for(auto & [key, one]: _parent->_ones) {
-    for(int two_id: one.prefs()) {
-      const Agent & two = _parent->_twos.at(two_id);
-      std::map<int, double> con;
-      // First sum
-      for(auto other: one.as_good_as(two)) {
-        con[_lr.at(one.id()).at(other)] -= 1;
-      }
-      // Second sum
-      for(auto other: two.as_good_as(one)) {
-        con[_lr.at(other).at(two.id())] -= 1;
-      }
-      CoinPackedVector coincon;
-      for(auto [conkey, value]: con) {
-        coincon.insert(conkey, value);
-      }
-      _constraints.appendRow(coincon);
-      // Want 1 - first_sum <= second sum
-      // 1 <= first_sum + second_sum
-      // -1 >= -first_sum - second_sum
-      _rhs.push_back(-1);
-      _lhs.push_back(-1.0 * _solverInterface.getInfinity());
+  for(int col = 0; col < num_cols(); ++col) {
+    if (_col_right_pos[col] >= 0) {
+      add_single_constraint(col);
     }
   }
 }
 
-void SMTI::IP_Model::add_merged_constraints() {
-
-  // For a two.id(), and an index into two's preference groups,
-  // better_than[two.id()][index] is a list of all variables corresponding to
-  // matches "at least as good as" any in the given group of twos preferences.
-  // Note that the indices to better_than (both of them) are going to have an
-  // off-by-one, as variables have to start at 1 (for SAT-solver reasons) but
-  // vectors start at 0.
-  std::map<int, std::map<int, std::list<int>>> better_than;
-
-  // Fill better_than
-  for(const auto & [key, one]: _parent->_ones) {
-    for(std::vector<signed int> tie: one.preferences()) {
-      for(auto pref: tie) {
-        int rank = _parent->_twos.at(pref).rank_of(one.id());
-        for(size_t l = rank; l <= _parent->_twos.at(pref).preferences().size(); ++l) {
-          better_than[pref][l].push_back(_lr.at(one.id()).at(pref));
-        }
+void SMTI::IP_Model::add_merged_constraint(int left, int rank) {
+  // This is the sum of the single constraints for each pair in the tie
+  // group, so the left sum is over everything up to the end of the group,
+  // once per pair, and each pair in the group is also in its own right sum.
+  int group = _left_group_offset[left] + rank;
+  int begin = (rank == 0) ? _left_start[left] : _left_group_end[group - 1];
+  int end = _left_group_end[group];
+  int size = 0;
+  for(int col = begin; col < end; ++col) {
+    if (_col_right_pos[col] >= 0) {
+      size++;
+    }
+  }
+  if (size == 0) {
+    return;
+  }
+  for(int col = _left_start[left]; col < end; ++col) {
+    _row_index.push_back(col);
+    bool in_right_sum = (col >= begin) && (_col_right_pos[col] >= 0);
+    _row_value.push_back(in_right_sum ? -(size + 1) : -size);
+  }
+  for(int col = begin; col < end; ++col) {
+    if (_col_right_pos[col] < 0) {
+      continue;
+    }
+    int right = _col_right[col];
+    int pos_end = _right_group_end[_col_right_pos[col]];
+    for(int pos = _right_start[right]; pos < pos_end; ++pos) {
+      int other = _right_cols[pos];
+      if ((other >= 0) && (other != col)) {
+        _row_index.push_back(other);
+        _row_value.push_back(-1);
       }
     }
   }
+  // size * ( 1 - left_side) <= right_side
+  // size - size * left <= right
+  // -right - size*left <= -size
+  end_row(-1.0 * COIN_DBL_MAX, -1.0 * size);
+}
 
-  for(auto & [key, one]: _parent->_ones) {
-    int group = 0;
-    // For these merged constraints, the left sum is going to be over "options
-    // that one has, that are better than two". Thus, as we progress down the
-    // preference list of one, we can slowly build up the list of variables in
-    // the left sum.
-    std::list<int> left;
-    for(const std::vector<signed int> & tie: one.preferences()) {
-      // The variables on the right sum
-      std::list<int> right;
-      for(signed int pref: tie) {
-        left.push_back(_lr.at(one.id()).at(pref));
-        int rank = _parent->_twos.at(pref).rank_of(one.id());
-        for(auto & var: better_than[pref][rank]) {
-          right.push_back(var);
+void SMTI::IP_Model::add_seed_constraints() {
+  // Start with the stability constraints for the first choices of each agent
+  // on the left. Blocking pairs are most often found amongst top choices, so
+  // this saves a few rounds of separation.
+  for(size_t left = 0; left < _left_ids.size(); ++left) {
+    if (_left_group_offset[left] == _left_group_offset[left + 1]) {
+      continue;
+    }
+    if (_merge) {
+      _separated_groups[_left_group_offset[left]] = true;
+      add_merged_constraint(left, 0);
+    } else {
+      for(int col = _left_start[left]; col < _left_group_end[_left_group_offset[left]]; ++col) {
+        if (_col_right_pos[col] >= 0) {
+          _separated_pairs[col] = true;
+          add_single_constraint(col);
         }
       }
-      // size * ( 1 - left_side) <= right_side
-      // size - size * left <= right
-      // -right - size*left <= -size
-      std::map<int, double> con;
-      for(auto & l : left) {
-        con[l] -= tie.size();
+    }
+  }
+}
+
+int SMTI::IP_Model::add_violated_constraints(const Matching & matching) {
+  // The rank of each agent's partner, or past the end of its preferences if
+  // unmatched.
+  std::vector<int> left_rank(_left_ids.size(), std::numeric_limits<int>::max());
+  std::vector<int> right_rank(_right_ids.size(), std::numeric_limits<int>::max());
+  for(auto [left, right]: matching) {
+    int col = column(left, right);
+    if (col < 0) {
+      continue;
+    }
+    left_rank[_col_left[col]] = _col_left_rank[col];
+    if (_col_right_pos[col] >= 0) {
+      right_rank[_col_right[col]] = _right_rank[_col_right_pos[col]];
+    }
+  }
+  int added = 0;
+  // A stability constraint is violated exactly when its pair is blocking,
+  // i.e. both agents are unmatched or strictly prefer each other to their
+  // partners. Walking each agent's strictly better prefix finds all of them
+  // with one look-up per acceptable pair.
+  for(size_t left = 0; left < _left_ids.size(); ++left) {
+    for(int col = _left_start[left]; col < _left_start[left + 1]; ++col) {
+      if (_col_left_rank[col] >= left_rank[left]) {
+        break;
       }
-      for(auto & r : right) {
-        con[r] -= 1;
+      int pos = _col_right_pos[col];
+      if ((pos < 0) || (_right_rank[pos] >= right_rank[_col_right[col]])) {
+        continue;
       }
-      CoinPackedVector coincon;
-      for(auto [conkey, value]: con) {
-        coincon.insert(conkey, value);
+      // Blocking pair found.
+      if (_merge) {
+        int group = _left_group_offset[left] + _col_left_rank[col];
+        if (!_separated_groups[group]) {
+          _separated_groups[group] = true;
+          add_merged_constraint(left, _col_left_rank[col]);
+          added++;
+        }
+      } else if (!_separated_pairs[col]) {
+        _separated_pairs[col] = true;
+        add_single_constraint(col);
+        added++;
       }
-      _constraints.appendRow(coincon);
-      _rhs.push_back(-1.0 * tie.size());
-      _lhs.push_back(-1.0 * _solverInterface.getInfinity());
-      group++;
+    }
+  }
+  SMTI_COUNT("ip_lazy_rows", added);
+  return added;
+}
+
+void SMTI::IP_Model::add_merged_constraints() {
+  for(size_t left = 0; left < _left_ids.size(); ++left) {
+    int groups = _left_group_offset[left + 1] - _left_group_offset[left];
+    for(int rank = 0; rank < groups; ++rank) {
+      add_merged_constraint(left, rank);
     }
   }
 }
@@ -115,6 +181,106 @@ std::list<Matching> SMTI::IP_Model::find_all_stable_matchings() {
   return all;
 }
 
+std::list<Matching> SMTI::IP_Model::find_all_stable_matchings(int threads) {
+  if (threads <= 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  // Each subproblem is a list of pairs to force, and a list to avoid.
+  struct Subproblem {
+    Matching forced;
+    Matching avoided;
+  };
+  std::vector<Subproblem> subproblems(1);
+  // Split on the agents on the left with the longest preference lists
+  // first, as they give the most subproblems: one for each acceptable
+  // partner, and one where the agent is unmatched. Every matching is in
+  // exactly one of these, so the results never need to be deduplicated.
+  std::vector<int> split_order;
+  for(auto & [key, one]: _parent->_ones) {
+    split_order.push_back(one.id());
+  }
+  std::sort(split_order.begin(), split_order.end(), [this](int a, int b) {
+    int a_prefs = _parent->_ones.at(a).num_prefs();
+    int b_prefs = _parent->_ones.at(b).num_prefs();
+    return (a_prefs != b_prefs) ? (a_prefs > b_prefs) : (a < b);
+  });
+  for(int left: split_order) {
+    if (subproblems.size() >= (size_t)(subproblems_per_thread * threads)) {
+      break;
+    }
+    const Agent & one = _parent->_ones.at(left);
+    if (one.num_prefs() == 0) {
+      break;
+    }
+    std::vector<Subproblem> split;
+    for(Subproblem & sub: subproblems) {
+      for(int right: one.prefs()) {
+        // Skip branches that clash with an earlier split.
+        bool clash = false;
+        for(auto [other_left, other_right]: sub.forced) {
+          clash = clash || (other_right == right);
+        }
+        if (!clash) {
+          split.push_back(sub);
+          split.back().forced.emplace_back(left, right);
+        }
+      }
+      split.push_back(std::move(sub));
+      for(int right: one.prefs()) {
+        split.back().avoided.emplace_back(left, right);
+      }
+    }
+    subproblems = std::move(split);
+  }
+
+  // Solve the subproblems on a pool of threads, each with its own copy of
+  // the base model. The base is built, or read from the cache, once here,
+  // so that the workers neither repeat the work nor touch the cache.
+  build_model();
+  std::vector<std::list<Matching>> found(subproblems.size());
+  std::atomic<size_t> next(0);
+  auto work = [&]() {
+    for(size_t index = next++; index < subproblems.size(); index = next++) {
+      IP_Model model(_parent);
+      model._merge = _merge;
+      model._lazy = _lazy;
+      model._heuristic_start = _heuristic_start;
+      model._backend_name = _backend_name;
+      model.copy_model(*this);
+      model._options = _options;
+      model._cancel = _cancel;
+      model.force(_forced);
+      model.force(_to_force);
+      model.force(subproblems[index].forced);
+      model.avoid(_avoided);
+      model.avoid(_to_avoid);
+      model.avoid(subproblems[index].avoided);
+      for(const Matching & avoid: _avoided_matchings) {
+        model.avoid_matching(avoid);
+      }
+      for(const Matching & avoid: _to_avoid_matchings) {
+        model.avoid_matching(avoid);
+      }
+      found[index] = model.find_all_stable_matchings();
+    }
+  };
+  std::vector<std::thread> pool;
+  for(int thread = 1; thread < threads; ++thread) {
+    pool.emplace_back(work);
+  }
+  work();
+  for(std::thread & thread: pool) {
+    thread.join();
+  }
+  // Joining in order of subproblem keeps the result the same for any
+  // number of threads.
+  std::list<Matching> all;
+  for(std::list<Matching> & matchings: found) {
+    all.splice(all.end(), matchings);
+  }
+  return all;
+}
+
 void SMTI::IP_Model::force(const Matching & forced) {
   for(auto [left, right]: forced) {
     _to_force.emplace_back(left, right);
@@ -131,51 +297,234 @@ void SMTI::IP_Model::avoid_matching(const Matching & avoid) {
   _to_avoid_matchings.push_back(avoid);
 }
 
-void SMTI::IP_Model::build_base() {
-  int num_cols = 0;
+void SMTI::IP_Model::backend(const std::string & name) {
+  // Creating the backend here means an unknown name is reported straight
+  // away, rather than at the next solve.
+  IP_Backend::create(name);
+  _backend_name = name;
+}
+
+void SMTI::IP_Model::clear_forces_avoids() {
+  _to_force.clear();
+  _forced.clear();
+  _to_avoid.clear();
+  _avoided.clear();
+  _infeasible = false;
+  for(int col = 0; col < num_cols(); ++col) {
+    _col_lb[col] = 0;
+    _col_ub[col] = (_col_right_pos[col] >= 0) ? 1 : 0;
+  }
+}
+
+int SMTI::IP_Model::column(int left, int right) const {
+  auto left_index = _left_index.find(left);
+  auto right_index = _right_index.find(right);
+  if ((left_index == _left_index.end()) || (right_index == _right_index.end())) {
+    return -1;
+  }
+  for(int col = _left_start[left_index->second]; col < _left_start[left_index->second + 1]; ++col) {
+    if (_col_right[col] == right_index->second) {
+      return col;
+    }
+  }
+  return -1;
+}
+
+void SMTI::IP_Model::build_index() {
   for(auto & [key, one]: _parent->_ones) {
-    for(int two_id: one.prefs()) {
-#ifdef DEBUG_IP_MODEL
-      std::cout << "Mapping " << one.id() << " with " << two_id << " is " << num_cols << std::endl;
-#endif
-      _lr[one.id()][two_id] = num_cols;
-      num_cols += 1;
+    _left_ids.push_back(one.id());
+  }
+  for(auto & [key, two]: _parent->_twos) {
+    _right_ids.push_back(two.id());
+  }
+  std::sort(_left_ids.begin(), _left_ids.end());
+  std::sort(_right_ids.begin(), _right_ids.end());
+  int num_left = _left_ids.size();
+  int num_right = _right_ids.size();
+  _left_index.reserve(num_left);
+  _right_index.reserve(num_right);
+  for(int i = 0; i < num_left; ++i) {
+    _left_index[_left_ids[i]] = i;
+  }
+  for(int j = 0; j < num_right; ++j) {
+    _right_index[_right_ids[j]] = j;
+  }
+
+  // Columns are numbered along the preferences of each left agent in turn.
+  _left_start.reserve(num_left + 1);
+  _left_group_offset.reserve(num_left + 1);
+  for(int i = 0; i < num_left; ++i) {
+    const Agent & one = _parent->_ones.at(_left_ids[i]);
+    _left_start.push_back(_col_left.size());
+    _left_group_offset.push_back(_left_group_end.size());
+    int rank = 0;
+    for(const std::vector<int> & tie: one.preferences()) {
+      for(int pref: tie) {
+        auto right = _right_index.find(pref);
+        _col_left.push_back(i);
+        _col_right.push_back((right == _right_index.end()) ? -1 : right->second);
+        _col_left_rank.push_back(rank);
+      }
+      _left_group_end.push_back(_col_left.size());
+      rank++;
+    }
+  }
+  _left_start.push_back(_col_left.size());
+  _left_group_offset.push_back(_left_group_end.size());
+
+  // Positions in the preferences of the right agents.
+  _right_start.reserve(num_right + 1);
+  for(int j = 0; j < num_right; ++j) {
+    const Agent & two = _parent->_twos.at(_right_ids[j]);
+    _right_start.push_back(_right_rank.size());
+    int rank = 0;
+    for(const std::vector<int> & tie: two.preferences()) {
+      for(size_t k = 0; k < tie.size(); ++k) {
+        _right_rank.push_back(rank);
+      }
+      _right_group_end.insert(_right_group_end.end(), tie.size(), _right_rank.size());
+      rank++;
+    }
+  }
+  _right_start.push_back(_right_rank.size());
+
+  // To match each position to its column without searching, bucket the
+  // positions by left agent. Then for each left agent, mark where it
+  // appears in the preferences of each right agent, and read these off
+  // along its own columns.
+  std::vector<int> bucket_start(num_left + 1, 0);
+  std::vector<int> pos_left(_right_rank.size(), -1);
+  for(int j = 0; j < num_right; ++j) {
+    int pos = _right_start[j];
+    for(const std::vector<int> & tie: _parent->_twos.at(_right_ids[j]).preferences()) {
+      for(int pref: tie) {
+        auto left = _left_index.find(pref);
+        if (left != _left_index.end()) {
+          pos_left[pos] = left->second;
+          bucket_start[left->second + 1]++;
+        }
+        pos++;
+      }
+    }
+  }
+  for(int i = 0; i < num_left; ++i) {
+    bucket_start[i + 1] += bucket_start[i];
+  }
+  std::vector<int> bucket_pos(bucket_start[num_left]);
+  std::vector<int> bucket_right(bucket_start[num_left]);
+  std::vector<int> fill(bucket_start.begin(), bucket_start.end() - 1);
+  for(int j = 0; j < num_right; ++j) {
+    for(int pos = _right_start[j]; pos < _right_start[j + 1]; ++pos) {
+      if (pos_left[pos] >= 0) {
+        bucket_pos[fill[pos_left[pos]]] = pos;
+        bucket_right[fill[pos_left[pos]]] = j;
+        fill[pos_left[pos]]++;
+      }
+    }
+  }
+  _right_cols.assign(_right_rank.size(), -1);
+  _col_right_pos.assign(_col_left.size(), -1);
+  std::vector<int> mark_owner(num_right, -1);
+  std::vector<int> mark_pos(num_right);
+  for(int i = 0; i < num_left; ++i) {
+    for(int b = bucket_start[i]; b < bucket_start[i + 1]; ++b) {
+      mark_owner[bucket_right[b]] = i;
+      mark_pos[bucket_right[b]] = bucket_pos[b];
+    }
+    for(int col = _left_start[i]; col < _left_start[i + 1]; ++col) {
+      int j = _col_right[col];
+      if ((j >= 0) && (mark_owner[j] == i)) {
+        _right_cols[mark_pos[j]] = col;
+        _col_right_pos[col] = mark_pos[j];
+      }
+    }
+  }
+}
+
+void SMTI::IP_Model::build_base() {
+  build_index();
+  int left_with_prefs = 0;
+  int right_with_prefs = 0;
+  for(size_t i = 0; i < _left_ids.size(); ++i) {
+    if (_left_start[i + 1] > _left_start[i]) {
+      left_with_prefs++;
+    }
+  }
+  for(size_t j = 0; j < _right_ids.size(); ++j) {
+    if (_right_start[j + 1] > _right_start[j]) {
+      right_with_prefs++;
     }
   }
-  _constraints.setDimensions(0, num_cols);
-  _col_lb = new double[num_cols];
-  _col_ub = new double[num_cols];
-  for(int i = 0; i < num_cols; ++i) {
-    _col_lb[i] = 0;
-    _col_ub[i] = 1;
+  _size_bound = std::min(left_with_prefs, right_with_prefs);
+  // A pair that only one side finds acceptable can never be matched.
+  _col_lb.assign(num_cols(), 0);
+  _col_ub.resize(num_cols());
+  for(int col = 0; col < num_cols(); ++col) {
+    _col_ub[col] = (_col_right_pos[col] >= 0) ? 1 : 0;
+  }
+  _separated_pairs.assign(num_cols(), false);
+  _separated_groups.assign(_left_group_end.size(), false);
+
+  // Reserve space for every row that will be built. Each stability
+  // constraint has at most as many entries as its two sums have columns.
+  size_t entries = _col_left.size() + _right_cols.size();
+  size_t rows = left_with_prefs + right_with_prefs;
+  if (!_lazy) {
+    for(int col = 0; col < num_cols(); ++col) {
+      if (_col_right_pos[col] < 0) {
+        continue;
+      }
+      int left = _col_left[col];
+      int right = _col_right[col];
+      int left_entries = _left_group_end[_left_group_offset[left] + _col_left_rank[col]] - _left_start[left];
+      int right_entries = _right_group_end[_col_right_pos[col]] - _right_start[right];
+      entries += right_entries;
+      if (_merge) {
+        // Left sums are shared by each tie group.
+        if ((col + 1 == _left_start[left + 1]) || (_col_left_rank[col + 1] != _col_left_rank[col])) {
+          entries += left_entries;
+          rows++;
+        }
+      } else {
+        entries += left_entries;
+        rows++;
+      }
+    }
   }
+  _row_start.reserve(rows + 1);
+  _row_lb.reserve(rows);
+  _row_ub.reserve(rows);
+  _row_index.reserve(entries);
+  _row_value.reserve(entries);
+  _row_start.push_back(0);
+
   // Ones capacity
-  for(auto & [key, one]: _parent->_ones) {
-    if (one.prefs().size() == 0) {
+  for(size_t i = 0; i < _left_ids.size(); ++i) {
+    if (_left_start[i + 1] == _left_start[i]) {
       continue;
     }
-    CoinPackedVector con;
-    for(int two_id: one.prefs()) {
-      con.insert(_lr[one.id()][two_id], 1);
+    for(int col = _left_start[i]; col < _left_start[i + 1]; ++col) {
+      _row_index.push_back(col);
+      _row_value.push_back(1);
     }
-    _rhs.push_back(1);
-    _constraints.appendRow(con);
-    _lhs.push_back(0);
+    end_row(0, 1);
   }
   // Twos capacity
-  for(auto & [key, two]: _parent->_twos) {
-    if (two.prefs().size() == 0) {
+  for(size_t j = 0; j < _right_ids.size(); ++j) {
+    if (_right_start[j + 1] == _right_start[j]) {
       continue;
     }
-    CoinPackedVector con;
-    for(int one_id: two.prefs()) {
-      con.insert(_lr[one_id][two.id()], 1);
+    for(int pos = _right_start[j]; pos < _right_start[j + 1]; ++pos) {
+      if (_right_cols[pos] >= 0) {
+        _row_index.push_back(_right_cols[pos]);
+        _row_value.push_back(1);
+      }
     }
-    _rhs.push_back(1);
-    _lhs.push_back(0);
-    _constraints.appendRow(con);
+    end_row(0, 1);
   }
-  if (_merge) {
+  if (_lazy) {
+    add_seed_constraints();
+  } else if (_merge) {
     add_merged_constraints();
   } else {
     add_single_constraints();
@@ -183,24 +532,49 @@ void SMTI::IP_Model::build_base() {
 }
 
 void SMTI::IP_Model::build_avoids_forces() {
+  // Forced and avoided pairs are expressed as bounds on the columns rather
+  // than as extra rows. Forcing (left, right) also means that no other pair
+  // containing either left or right can be in the matching, so those columns
+  // are fixed at zero straight away.
   for(auto [left, right]: _to_force) {
-    CoinPackedVector con;
-    con.insert(_lr[left][right], 1);
-    _constraints.appendRow(con);
-    _lhs.push_back(1);
-    _rhs.push_back(1);
+    int col = column(left, right);
+    if ((col < 0) || (_col_right_pos[col] < 0)) {
+      // Forcing an unacceptable pair can never be satisfied.
+      _infeasible = true;
+      continue;
+    }
+    int left_index = _col_left[col];
+    int right_index = _col_right[col];
+    for(int other = _left_start[left_index]; other < _left_start[left_index + 1]; ++other) {
+      if (other != col) {
+        _col_ub[other] = 0;
+      }
+    }
+    for(int pos = _right_start[right_index]; pos < _right_start[right_index + 1]; ++pos) {
+      int other = _right_cols[pos];
+      if ((other >= 0) && (other != col)) {
+        _col_ub[other] = 0;
+      }
+    }
+    _col_lb[col] = 1;
   }
   std::move(_to_force.begin(), _to_force.end(), std::back_inserter(_forced));
   _to_force.clear();
   for(auto [left, right]: _to_avoid) {
-    CoinPackedVector con;
-    con.insert(_lr[left][right], 1);
-    _constraints.appendRow(con);
-    _lhs.push_back(0);
-    _rhs.push_back(0);
+    int col = column(left, right);
+    if (col >= 0) {
+      _col_ub[col] = 0;
+    }
   }
   std::move(_to_avoid.begin(), _to_avoid.end(), std::back_inserter(_avoided));
   _to_avoid.clear();
+  // Two forced pairs may share an agent, in which case some column now has
+  // to be both 0 and 1.
+  for(int col = 0; col < num_cols(); ++col) {
+    if (_col_lb[col] > _col_ub[col]) {
+      _infeasible = true;
+    }
+  }
 
   for(auto avoid: _to_avoid_matchings) {
     // Avoid the given matching
@@ -212,82 +586,316 @@ void SMTI::IP_Model::build_avoids_forces() {
     // 0) and a final constraint ensuring sum(x_P) >= 1 (i.e., at least one
     // variable is different.
     // Currently I'm implementing the first, as it doesn't require more
-    // variables.
-    CoinPackedVector con;
+    // variables. Pairs without a column are never in a solution, so they
+    // are left out of the sum.
     for(auto [left, right]: avoid) {
-      con.insert(_lr[left][right], 1);
+      int col = column(left, right);
+      if (col >= 0) {
+        _row_index.push_back(col);
+        _row_value.push_back(1);
+      }
     }
-    _constraints.appendRow(con);
-    _lhs.push_back(0);
     // Ensure the number of common variables between avoid and a solution is at
     // most (avoid.size() - 1)
-    _rhs.push_back(avoid.size() - 1);
+    end_row(0, avoid.size() - 1);
   }
   std::move(_to_avoid_matchings.begin(), _to_avoid_matchings.end(), std::back_inserter(_avoided_matchings));
   _to_avoid_matchings.clear();
 }
 
-Matching SMTI::IP_Model::solve(){
+Matching SMTI::IP_Model::solve() {
+  Result result = solve_detailed();
+  if (result.status != Optimal) {
+    return Matching();
+  }
+  return result.matching;
+}
+
+double SMTI::IP_Model::elapsed() const {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - _solve_start).count();
+}
+
+void SMTI::IP_Model::build_model() {
   if (!_built) {
-    build_base();
+    // A model that cannot fit is never built, nor written to the cache.
+    if (_parent->_memory_budget > 0) {
+      check_memory_budget(minimum_memory_usage());
+    }
+    bool cached = load_cache();
+    if (!cached) {
+      SMTI_TIME("ip_build");
+      build_base();
+    }
+    check_memory_budget(memory_usage());
+    if (!cached) {
+      save_cache();
+    }
     _built = true;
   }
+}
+
+void SMTI::IP_Model::prepare() {
+  _solve_start = std::chrono::steady_clock::now();
+  build_model();
   build_avoids_forces();
-  double* objective = new double[_constraints.getNumCols()];
-  for(int i = 0; i < _constraints.getNumCols(); ++i) {
-    objective[i] = 1;
-  }
+}
 
-  // Now we have to convert our std::list to a double[]
-  double* my_lhs = new double[_constraints.getNumRows()];
-  double* my_rhs = new double[_constraints.getNumRows()];
+bool SMTI::IP_Model::solve_relaxation() {
+  prepare();
+  if (_infeasible) {
+    return false;
+  }
+  // Symphony only solves the relaxation by running its branch and bound
+  // without integer columns, and has no reduced costs, so use Clp if we can.
+  std::vector<std::string> names = IP_Backend::available();
+  bool have_clp = std::find(names.begin(), names.end(), "clp") != names.end();
+  load_problem(have_clp ? "clp" : _backend_name, false);
+  _backend->set_options(_options);
   {
-    // Fill inside a block so that the scope of i is minimised
-    int i = 0;
-    for(auto left: _lhs) {
-      my_lhs[i] = left;
-      i++;
+    SMTI_TIME("ip_solve_lp");
+    _backend->solve_lp();
+  }
+  return _backend->solver().isProvenOptimal();
+}
+
+double SMTI::IP_Model::lp_bound() {
+  if (!solve_relaxation()) {
+    if (_infeasible || _backend->solver().isProvenPrimalInfeasible()) {
+      return -1;
+    }
+    return _size_bound;
+  }
+  return std::min(_backend->solver().getObjValue(), (double)_size_bound);
+}
+
+bool SMTI::IP_Model::may_achieve(int size) {
+  return lp_bound() >= size - epsilon;
+}
+
+Matching SMTI::IP_Model::reduced_cost_fixing(int target) {
+  Matching fixed;
+  if (!solve_relaxation()) {
+    return fixed;
+  }
+  const OsiSolverInterface & solver = _backend->solver();
+  double bound = solver.getObjValue();
+  const double* reduced = solver.getReducedCost();
+  const double* solution = solver.getColSolution();
+  if ((reduced == nullptr) || (bound < target - epsilon)) {
+    return fixed;
+  }
+  // A column at zero in an optimal solution of the relaxation can only be
+  // raised to one by giving up at least its reduced cost. If that takes the
+  // bound below target, the pair is in no matching of size target.
+  for(int col = 0; col < num_cols(); ++col) {
+    if ((_col_ub[col] == 0) || (solution[col] > epsilon)) {
+      continue;
     }
-    i = 0;
-    for(auto right: _rhs) {
-      my_rhs[i] = right;
-      i++;
+    if (bound - std::fabs(reduced[col]) < target - epsilon) {
+      fixed.emplace_back(_left_ids[_col_left[col]], _right_ids[_col_right[col]]);
     }
   }
-#ifdef DEBUG_IP_MODEL
-  for(int row = 0; row < _constraints.getNumRows(); ++row) {
-    std::cout << my_lhs[row] << " ≤";
-    for(int col = 0; col < _constraints.getNumCols(); ++col) {
-      if (_constraints.getCoefficient(row, col) != 0) {
-        std::cout << " " << _constraints.getCoefficient(row, col) << "x" << col;
+  avoid(fixed);
+  return fixed;
+}
+
+SMTI::IP_Model::Result SMTI::IP_Model::solve_detailed() {
+  SMTI_TIME("ip_solve");
+  prepare();
+  Result result;
+  if (_infeasible) {
+    // No need to ask the solver, the bounds already conflict.
+    result.status = Infeasible;
+    return result;
+  }
+  if (_heuristic_start && _start.empty()) {
+    std::mt19937 generator;
+    for(int attempt = 0; attempt < heuristic_attempts; ++attempt) {
+      Matching found = _parent->gale_shapley(generator);
+      if (found.size() > _start.size()) {
+        _start = std::move(found);
       }
     }
-    std::cout << " ≤ " << my_rhs[row] << std::endl;
   }
-  for(int col = 0; col < _constraints.getNumCols(); ++col) {
-    std::cout << col_lb[col] << " ≤ " << "x" << col << " ≤ " << col_ub[col] << std::endl;
+  result = solve_current();
+  if (_lazy) {
+    // Each solution is optimal for a relaxation, so the first one that is
+    // also stable is optimal for the full model.
+    while ((result.status == Optimal) && (!result.matching.empty()) &&
+           (add_violated_constraints(result.matching) > 0)) {
+      int nodes = result.nodes;
+      result = solve_current();
+      result.nodes += nodes;
+    }
+    // If stopped early, the incumbent need not be stable, but the bound from
+    // the relaxation still holds. The check leaves the model alone, as
+    // adding the violated rows here would only grow it, by every row if
+    // there is no incumbent. The start only passed the rows built so far,
+    // so it is checked the same way before falling back to it.
+    if ((result.status != Optimal) && !_parent->check_stability(result.matching).stable()) {
+      bool start_stable = _start_used && _parent->check_stability(_start).stable();
+      result.matching = start_stable ? _start : Matching();
+    }
+  }
+  result.seconds = elapsed();
+  if (_progress) {
+    IP_Progress now;
+    now.incumbent = result.matching.size();
+    now.bound = result.bound;
+    now.nodes = result.nodes;
+    now.seconds = result.seconds;
+    _progress(now);
+  }
+  return result;
+}
+
+bool SMTI::IP_Model::start_solution(std::vector<double> & start) const {
+  if (_start.empty()) {
+    return false;
+  }
+  start.assign(num_cols(), 0);
+  for(auto [left, right]: _start) {
+    int col = column(left, right);
+    if (col < 0) {
+      return false;
+    }
+    start[col] = 1;
+  }
+  for(int col = 0; col < num_cols(); ++col) {
+    if ((start[col] < _col_lb[col]) || (start[col] > _col_ub[col])) {
+      return false;
+    }
+  }
+  // Checking every row also catches matchings that have since been avoided.
+  for(int row = 0; row < num_rows(); ++row) {
+    double activity = 0;
+    for(CoinBigIndex k = _row_start[row]; k < _row_start[row + 1]; ++k) {
+      activity += _row_value[k] * start[_row_index[k]];
+    }
+    if ((activity < _row_lb[row] - epsilon) || (activity > _row_ub[row] + epsilon)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void SMTI::IP_Model::load_problem(const std::string & backend_name, bool integer) {
+  std::vector<double> objective(num_cols(), 1);
+  std::vector<double> row_lb(_row_lb);
+#ifdef DEBUG_IP_MODEL
+  for(int row = 0; row < num_rows(); ++row) {
+    std::cout << row_lb[row] << " ≤";
+    for(CoinBigIndex k = _row_start[row]; k < _row_start[row + 1]; ++k) {
+      std::cout << " " << _row_value[k] << "x" << _row_index[k];
+    }
+    std::cout << " ≤ " << _row_ub[row] << std::endl;
+  }
+  for(int col = 0; col < num_cols(); ++col) {
+    std::cout << _col_lb[col] << " ≤ " << "x" << col << " ≤ " << _col_ub[col] << std::endl;
   }
 #endif
-  _solverInterface.loadProblem(_constraints, _col_lb, _col_ub, objective, my_lhs, my_rhs);
-  for(int i = 0; i < _constraints.getNumCols(); ++i) {
-    _solverInterface.setInteger(i);
-  }
-  _solverInterface.setObjSense(-1.0); // -1.0 is maximise, 1.0 is minimise
-  _solverInterface.setSymParam(OsiSymVerbosity, -2);
-  _solverInterface.initialSolve();
-  Matching result;
-  if (! _solverInterface.isProvenOptimal()) {
-    return result;
+  // Start from a fresh solver, so that a cutoff given with an earlier
+  // starting solution does not carry over.
+  _backend = IP_Backend::create(backend_name);
+  OsiSolverInterface & solver = _backend->solver();
+  for(double & lower: row_lb) {
+    if (lower <= -COIN_DBL_MAX) {
+      lower = -solver.getInfinity();
+    }
+  }
+  // The rows are handed over in one go, as a row ordered matrix without gaps.
+  std::vector<int> row_length(num_rows());
+  for(int row = 0; row < num_rows(); ++row) {
+    row_length[row] = _row_start[row + 1] - _row_start[row];
+  }
+  CoinPackedMatrix matrix(false, num_cols(), num_rows(), _row_index.size(),
+                          _row_value.data(), _row_index.data(), _row_start.data(),
+                          row_length.data());
+  solver.loadProblem(matrix, _col_lb.data(), _col_ub.data(), objective.data(),
+                     row_lb.data(), _row_ub.data());
+  if (integer) {
+    for(int col = 0; col < num_cols(); ++col) {
+      solver.setInteger(col);
+    }
+  }
+  solver.setObjSense(-1.0); // -1.0 is maximise, 1.0 is minimise
+}
+
+SMTI::IP_Model::Result SMTI::IP_Model::solve_current() {
+  SMTI_TIME("ip_solver");
+  load_problem(_backend_name, true);
+  OsiSolverInterface & solver = _backend->solver();
+  IP_Options options = _options;
+  if (_options.time_limit >= 0) {
+    // The limit is for the whole of solve_detailed().
+    options.time_limit = std::max(0.0, _options.time_limit - elapsed());
   }
-  for(auto [left_id, right_map]: _lr) {
-    for(auto [right_id, var_id]: right_map) {
-      if (_solverInterface.getColSolution()[var_id] >= 1.0 - epsilon) {
-        result.emplace_back(left_id, right_id);
+  _backend->set_options(options);
+  std::vector<double> start;
+  _start_used = start_solution(start);
+  if (_start_used) {
+    solver.setColSolution(start.data());
+    // Every objective coefficient is 1, so only solutions that are larger by
+    // at least one are of interest.
+    _backend->set_cutoff(_start.size(), 1.0 - epsilon);
+  }
+  IP_Backend::Monitor monitor = [this](IP_Progress & now) {
+    now.seconds = elapsed();
+    if (_start_used && (now.incumbent < _start.size())) {
+      now.incumbent = _start.size();
+    }
+    now.bound = std::min(now.bound, (double)_size_bound);
+    if (_progress) {
+      _progress(now);
+    }
+    if (_cancel.cancelled()) {
+      _interrupted = Cancelled;
+      return false;
+    }
+    if ((_options.time_limit >= 0) && (now.seconds >= _options.time_limit)) {
+      _interrupted = Limit;
+      return false;
+    }
+    return true;
+  };
+  _interrupted = Optimal;
+  if (_cancel.cancelled()) {
+    _interrupted = Cancelled;
+  } else {
+    _backend->solve_mip(monitor);
+  }
+  Result result;
+  result.nodes = _backend->nodes();
+  if ((_interrupted != Cancelled) || (_backend->has_solution())) {
+    if (solver.isProvenOptimal() || _backend->has_solution()) {
+      const double* solution = solver.getColSolution();
+      for(int col = 0; col < num_cols(); ++col) {
+        if (solution[col] >= 1.0 - epsilon) {
+          result.matching.emplace_back(_left_ids[_col_left[col]], _right_ids[_col_right[col]]);
+        }
       }
     }
   }
-  delete[] objective;
-  delete[] my_lhs;
-  delete[] my_rhs;
+  // With the cutoff in place, the solver may finish without returning a
+  // solution at all, in which case the start is the best there is.
+  if (_start_used && (result.matching.size() < _start.size())) {
+    result.matching = _start;
+  }
+  if (_interrupted != Optimal) {
+    result.status = _interrupted;
+  } else if (solver.isProvenOptimal()) {
+    result.status = Optimal;
+  } else if (solver.isProvenPrimalInfeasible()) {
+    result.status = _start_used ? Optimal : Infeasible;
+  } else if (_backend->limit_reached()) {
+    result.status = Limit;
+  } else {
+    result.status = Failed;
+  }
+  if (result.status == Optimal) {
+    result.bound = result.matching.size();
+  } else if (result.status != Infeasible) {
+    result.bound = std::min(_backend->best_bound(), (double)_size_bound);
+  }
   return result;
 }
@@ -0,0 +1,410 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <type_traits>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "smti.h"
+
+namespace {
+  // Identifies cache files, and must change whenever their layout does.
+  const char cache_magic[8] = {'S', 'M', 'T', 'I', 'I', 'P', '0', '2'};
+
+  const uint64_t fnv_offset = 14695981039346656037ULL;
+  const uint64_t fnv_prime = 1099511628211ULL;
+
+  // Add value to a 64-bit FNV-1a hash.
+  void fnv(uint64_t & hash, int64_t value) {
+    for(size_t byte = 0; byte < sizeof(value); ++byte) {
+      hash ^= (value >> (8 * byte)) & 0xff;
+      hash *= fnv_prime;
+    }
+  }
+
+  // Add bytes to a 64-bit FNV-1a hash.
+  void fnv_bytes(uint64_t & hash, const char * data, size_t size) {
+    for(size_t byte = 0; byte < size; ++byte) {
+      hash ^= (unsigned char)data[byte];
+      hash *= fnv_prime;
+    }
+  }
+
+  // Write values, adding what is written to checksum.
+  template <typename T>
+  void write_vector(std::ostream & out, const std::vector<T> & values, uint64_t & checksum) {
+    uint64_t size = values.size();
+    out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    out.write(reinterpret_cast<const char*>(values.data()), size * sizeof(T));
+    fnv_bytes(checksum, reinterpret_cast<const char*>(&size), sizeof(size));
+    fnv_bytes(checksum, reinterpret_cast<const char*>(values.data()), size * sizeof(T));
+  }
+
+  void write_vector(std::ostream & out, const std::vector<bool> & values, uint64_t & checksum) {
+    write_vector(out, std::vector<char>(values.begin(), values.end()), checksum);
+  }
+
+  // Read values written by write_vector(), adding them to checksum. Fails
+  // rather than allocating if the stored size is more than the remaining
+  // bytes of the file could hold.
+  template <typename T>
+  bool read_vector(std::istream & in, std::vector<T> & values, uint64_t & checksum, uint64_t & remaining) {
+    uint64_t size;
+    if ((remaining < sizeof(size)) || !in.read(reinterpret_cast<char*>(&size), sizeof(size))) {
+      return false;
+    }
+    remaining -= sizeof(size);
+    if (size > remaining / sizeof(T)) {
+      return false;
+    }
+    remaining -= size * sizeof(T);
+    values.resize(size);
+    if (!in.read(reinterpret_cast<char*>(values.data()), size * sizeof(T))) {
+      return false;
+    }
+    fnv_bytes(checksum, reinterpret_cast<const char*>(&size), sizeof(size));
+    fnv_bytes(checksum, reinterpret_cast<const char*>(values.data()), size * sizeof(T));
+    return true;
+  }
+
+  bool read_vector(std::istream & in, std::vector<bool> & values, uint64_t & checksum, uint64_t & remaining) {
+    std::vector<char> stored;
+    if (!read_vector(in, stored, checksum, remaining)) {
+      return false;
+    }
+    values.assign(stored.begin(), stored.end());
+    return true;
+  }
+
+  // Whether offsets runs from 0 to end without decreasing, with count + 1
+  // entries.
+  template <typename T>
+  bool valid_offsets(const std::vector<T> & offsets, size_t count, size_t end) {
+    if ((offsets.size() != count + 1) || (offsets[0] != 0) || ((size_t)offsets[count] != end)) {
+      return false;
+    }
+    for(size_t k = 0; k < count; ++k) {
+      if (offsets[k] > offsets[k + 1]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Whether every value is at least low and less than high.
+  template <typename T>
+  bool in_range(const std::vector<T> & values, int64_t low, int64_t high) {
+    for(T value: values) {
+      if ((value < low) || (value >= high)) {
+        return false;
+      }
+    }
+    return true;
+  }
+} // namespace
+
+void SMTI::IP_Model::name_columns() {
+  OsiSolverInterface & solver = _backend->solver();
+  solver.setIntParam(OsiNameDiscipline, 2);
+  for(int col = 0; col < num_cols(); ++col) {
+    std::stringstream name;
+    name << "x_" << _left_ids[_col_left[col]] << "_" << _right_ids[_col_right[col]];
+    solver.setColName(col, name.str());
+  }
+}
+
+void SMTI::IP_Model::write_mps(const std::string & filename) {
+  prepare();
+  load_problem(_backend_name, true);
+  name_columns();
+  // An empty extension stops Osi adding one to the filename.
+  _backend->solver().writeMps(filename.c_str(), "");
+}
+
+void SMTI::IP_Model::write_lp(const std::string & filename) {
+  prepare();
+  load_problem(_backend_name, true);
+  name_columns();
+  _backend->solver().writeLp(filename.c_str(), "");
+}
+
+uint64_t SMTI::IP_Model::cache_key() const {
+  uint64_t hash = fnv_offset;
+  fnv(hash, sizeof(CoinBigIndex));
+  fnv(hash, _merge);
+  fnv(hash, _lazy);
+  // Hash the agents in order of ID, so that the key does not depend on the
+  // order of the unordered_maps.
+  for(const std::unordered_map<int, Agent> * side: {&_parent->_ones, &_parent->_twos}) {
+    std::vector<int> ids;
+    ids.reserve(side->size());
+    for(auto & [key, agent]: *side) {
+      ids.push_back(agent.id());
+    }
+    std::sort(ids.begin(), ids.end());
+    fnv(hash, ids.size());
+    for(int id: ids) {
+      const Agent & agent = side->at(id);
+      fnv(hash, id);
+      fnv(hash, agent.preferences().size());
+      for(const std::vector<int> & tie: agent.preferences()) {
+        fnv(hash, tie.size());
+        for(int pref: tie) {
+          fnv(hash, pref);
+        }
+      }
+    }
+  }
+  return hash;
+}
+
+std::string SMTI::IP_Model::cache_file(uint64_t key) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "ip-%016llx.cache", (unsigned long long)key);
+  return _cache_directory + "/" + name;
+}
+
+template <typename Model, typename Function>
+void SMTI::IP_Model::visit_model(Model & model, Function visit) {
+  visit(model._left_ids);
+  visit(model._right_ids);
+  visit(model._left_start);
+  visit(model._left_group_offset);
+  visit(model._left_group_end);
+  visit(model._right_start);
+  visit(model._right_cols);
+  visit(model._right_rank);
+  visit(model._right_group_end);
+  visit(model._col_left);
+  visit(model._col_right);
+  visit(model._col_left_rank);
+  visit(model._col_right_pos);
+  visit(model._row_start);
+  visit(model._row_index);
+  visit(model._row_value);
+  visit(model._row_lb);
+  visit(model._row_ub);
+  visit(model._col_lb);
+  visit(model._col_ub);
+  visit(model._separated_pairs);
+  visit(model._separated_groups);
+}
+
+bool SMTI::IP_Model::load_cache() {
+  if (_cache_directory.empty()) {
+    return false;
+  }
+  uint64_t key = cache_key();
+  std::ifstream in(cache_file(key), std::ios::binary | std::ios::ate);
+  if (!in) {
+    return false;
+  }
+  uint64_t remaining = in.tellg();
+  in.seekg(0);
+  char magic[sizeof(cache_magic)];
+  uint64_t stored_key;
+  size_t header = sizeof(magic) + sizeof(stored_key) + sizeof(_size_bound);
+  if ((remaining < header) || !in.read(magic, sizeof(magic)) ||
+      !std::equal(magic, magic + sizeof(magic), cache_magic) ||
+      !in.read(reinterpret_cast<char*>(&stored_key), sizeof(stored_key)) || (stored_key != key) ||
+      !in.read(reinterpret_cast<char*>(&_size_bound), sizeof(_size_bound))) {
+    return false;
+  }
+  remaining -= header;
+  uint64_t checksum = fnv_offset;
+  fnv_bytes(checksum, reinterpret_cast<const char*>(&_size_bound), sizeof(_size_bound));
+  bool ok = true;
+  visit_model(*this, [&](auto & values) { ok = ok && read_vector(in, values, checksum, remaining); });
+  uint64_t stored_checksum;
+  ok = ok && (remaining == sizeof(stored_checksum)) &&
+       in.read(reinterpret_cast<char*>(&stored_checksum), sizeof(stored_checksum)) &&
+       (stored_checksum == checksum) && consistent_model();
+  if (!ok) {
+    // Leave a clean model for build_base().
+    visit_model(*this, [](auto & values) { values.clear(); });
+    return false;
+  }
+  for(size_t i = 0; i < _left_ids.size(); ++i) {
+    _left_index[_left_ids[i]] = i;
+  }
+  for(size_t j = 0; j < _right_ids.size(); ++j) {
+    _right_index[_right_ids[j]] = j;
+  }
+  return true;
+}
+
+void SMTI::IP_Model::copy_model(const IP_Model & base) {
+  // Both models are visited in the same order, so the kth array of one has
+  // the type of the kth array of the other.
+  std::vector<const void*> arrays;
+  visit_model(base, [&arrays](const auto & values) { arrays.push_back(&values); });
+  size_t next = 0;
+  visit_model(*this, [&arrays, &next](auto & values) {
+    values = *static_cast<const std::decay_t<decltype(values)>*>(arrays[next++]);
+  });
+  _left_index = base._left_index;
+  _right_index = base._right_index;
+  _size_bound = base._size_bound;
+  _built = true;
+}
+
+bool SMTI::IP_Model::consistent_model() const {
+  size_t num_left = _left_ids.size();
+  size_t num_right = _right_ids.size();
+  size_t num_cols = _col_left.size();
+  size_t num_positions = _right_rank.size();
+  size_t num_groups = _left_group_end.size();
+  size_t num_rows = _row_lb.size();
+  if ((num_left != _parent->_ones.size()) || (num_right != _parent->_twos.size())) {
+    return false;
+  }
+  for(auto [ids, agents]: {std::make_pair(&_left_ids, &_parent->_ones),
+                           std::make_pair(&_right_ids, &_parent->_twos)}) {
+    for(size_t k = 0; k < ids->size(); ++k) {
+      if (((k > 0) && ((*ids)[k - 1] >= (*ids)[k])) || (agents->count((*ids)[k]) == 0)) {
+        return false;
+      }
+    }
+  }
+  // Offsets, and the lengths of the arrays they index.
+  if (!valid_offsets(_left_start, num_left, num_cols) ||
+      !valid_offsets(_left_group_offset, num_left, num_groups) ||
+      !valid_offsets(_right_start, num_right, num_positions) ||
+      !valid_offsets(_row_start, num_rows, _row_index.size()) ||
+      (_right_cols.size() != num_positions) || (_right_group_end.size() != num_positions) ||
+      (_col_right.size() != num_cols) || (_col_left_rank.size() != num_cols) ||
+      (_col_right_pos.size() != num_cols) || (_col_lb.size() != num_cols) ||
+      (_col_ub.size() != num_cols) || (_row_value.size() != _row_index.size()) ||
+      (_row_ub.size() != num_rows) || (_separated_pairs.size() != num_cols) ||
+      (_separated_groups.size() != num_groups)) {
+    return false;
+  }
+  // Indices into other arrays.
+  if (!in_range(_col_right, -1, num_right) || !in_range(_col_right_pos, -1, num_positions) ||
+      !in_range(_right_cols, -1, num_cols) || !in_range(_row_index, 0, num_cols) ||
+      !in_range(_col_left_rank, 0, num_cols) || !in_range(_right_rank, 0, num_positions)) {
+    return false;
+  }
+  for(size_t i = 0; i < num_left; ++i) {
+    int previous = _left_start[i];
+    for(int group = _left_group_offset[i]; group < _left_group_offset[i + 1]; ++group) {
+      if ((_left_group_end[group] < previous) || (_left_group_end[group] > _left_start[i + 1])) {
+        return false;
+      }
+      previous = _left_group_end[group];
+    }
+    for(int col = _left_start[i]; col < _left_start[i + 1]; ++col) {
+      if (_col_left[col] != (int)i) {
+        return false;
+      }
+    }
+  }
+  for(size_t j = 0; j < num_right; ++j) {
+    for(int pos = _right_start[j]; pos < _right_start[j + 1]; ++pos) {
+      if ((_right_group_end[pos] <= pos) || (_right_group_end[pos] > _right_start[j + 1])) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void SMTI::IP_Model::save_cache() {
+  if (_cache_directory.empty()) {
+    return;
+  }
+  uint64_t key = cache_key();
+  // Write to a temporary file with a unique name first, so that other
+  // processes or threads writing the same entry never share it, and no one
+  // sees a partly written cache. Failing to write the cache is not an
+  // error, the model is just built again next time.
+  std::string filename = cache_file(key);
+  std::vector<char> name(filename.begin(), filename.end());
+  for(char c: std::string(".XXXXXX")) {
+    name.push_back(c);
+  }
+  name.push_back('\0');
+  int fd = mkstemp(name.data());
+  if (fd == -1) {
+    return;
+  }
+  // mkstemp() makes the file private, but a cache is meant to be shared.
+  fchmod(fd, 0644);
+  close(fd);
+  std::string partial(name.data());
+  {
+    std::ofstream out(partial, std::ios::binary);
+    out.write(cache_magic, sizeof(cache_magic));
+    out.write(reinterpret_cast<const char*>(&key), sizeof(key));
+    out.write(reinterpret_cast<const char*>(&_size_bound), sizeof(_size_bound));
+    uint64_t checksum = fnv_offset;
+    fnv_bytes(checksum, reinterpret_cast<const char*>(&_size_bound), sizeof(_size_bound));
+    visit_model(*this, [&out, &checksum](auto & values) { write_vector(out, values, checksum); });
+    out.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+    if (!out) {
+      out.close();
+      std::remove(partial.c_str());
+      return;
+    }
+  }
+  if (std::rename(partial.c_str(), filename.c_str()) != 0) {
+    std::remove(partial.c_str());
+  }
+}
+
+size_t SMTI::IP_Model::memory_usage() const {
+  size_t bytes = 0;
+  visit_model(*this, [&bytes](const auto & values) {
+    using Value = typename std::decay_t<decltype(values)>::value_type;
+    if constexpr (std::is_same_v<Value, bool>) {
+      bytes += values.capacity() / 8;
+    } else {
+      bytes += values.capacity() * sizeof(Value);
+    }
+  });
+  for(const std::unordered_map<int, int> * index: {&_left_index, &_right_index}) {
+    bytes += index->bucket_count() * sizeof(void*) +
+             index->size() * (sizeof(std::pair<const int, int>) + sizeof(void*));
+  }
+  return bytes;
+}
+
+size_t SMTI::IP_Model::minimum_memory_usage() const {
+  // Each agent has an ID, a start and an index entry, each agent on the
+  // left a group offset and each of its groups an end. Each preference on
+  // the left is a column with four ints and two bounds, and each on the
+  // right a position with three ints. Rows are not counted, as how many
+  // there are depends on the build.
+  size_t bytes = 0;
+  for(const std::unordered_map<int, Agent> * side: {&_parent->_ones, &_parent->_twos}) {
+    bool left = (side == &_parent->_ones);
+    for(auto & [id, agent]: *side) {
+      bytes += 2 * sizeof(int) + sizeof(std::pair<const int, int>) + sizeof(void*);
+      if (left) {
+        bytes += (1 + agent.preferences().size()) * sizeof(int) +
+                 agent.num_prefs() * (4 * sizeof(int) + 2 * sizeof(double));
+      } else {
+        bytes += agent.num_prefs() * 3 * sizeof(int);
+      }
+    }
+  }
+  return bytes;
+}
+
+void SMTI::IP_Model::check_memory_budget(size_t model_bytes) {
+  size_t budget = _parent->_memory_budget;
+  if (budget == 0) {
+    return;
+  }
+  size_t bytes = _parent->memory_usage().total() + model_bytes;
+  if (bytes > budget) {
+    // Free the model, and leave it clean to be built again.
+    visit_model(*this, [](auto & values) { values = std::decay_t<decltype(values)>(); });
+    _left_index.clear();
+    _right_index.clear();
+    throw MemoryBudgetExceeded("ip_build needs at least " + std::to_string(bytes) +
+                               " bytes, over the memory budget of " + std::to_string(budget) + " bytes");
+  }
+}
@@ -0,0 +1,46 @@
+#include <sstream>
+#include "smti.h"
+
+namespace {
+  // Bytes held by an unordered_map: a pointer per bucket, and for each entry
+  // a node holding the entry, a pointer to the next node and the hash.
+  template <typename Map>
+  size_t map_bytes(const Map & map) {
+    return map.bucket_count() * sizeof(void*) +
+           map.size() * (sizeof(typename Map::value_type) + sizeof(void*) + sizeof(size_t));
+  }
+
+  std::string over_budget(const char * phase, size_t bytes, size_t budget) {
+    return std::string(phase) + " needs at least " + std::to_string(bytes) +
+           " bytes, over the memory budget of " + std::to_string(budget) + " bytes";
+  }
+} // namespace
+
+SMTI::MemoryUsage SMTI::memory_usage() const {
+  MemoryUsage usage;
+  for(const std::unordered_map<int, Agent> * side: {&_ones, &_twos}) {
+    usage.preferences += map_bytes(*side);
+    for(auto & [id, agent]: *side) {
+      usage.preferences += agent.memory_usage();
+    }
+  }
+  usage.variable_maps = map_bytes(_one_vars) + map_bytes(_two_vars);
+  usage.encoding = _encoding_bytes;
+  return usage;
+}
+
+size_t SMTI::start_encoding() {
+  _encoding_bytes = 0;
+  if (_memory_budget == 0) {
+    return 0;
+  }
+  return memory_usage().total();
+}
+
+void SMTI::check_memory_budget(const char * phase, size_t base, std::stringstream & encoding) {
+  size_t bytes = encoding.tellp();
+  _encoding_bytes = std::max(_encoding_bytes, bytes);
+  if ((_memory_budget > 0) && (base + 3 * bytes > _memory_budget)) {
+    throw MemoryBudgetExceeded(over_budget(phase, base + 3 * bytes, _memory_budget));
+  }
+}
@@ -5,13 +5,32 @@
  * algorithms exists in an anonymous namespace declared first.
  */
 
+#include <algorithm>
 #include <unordered_set>
 #include <iostream>
 #include "Agent.h"
 #include "Graph.h"
+#include "Stats.h"
 #include "smti.h"
 
 namespace {
+  // The agents of one side numbered 0, 1, ... in order of ID, so that the
+  // graph is sized by the number of agents rather than by the largest ID.
+  std::unordered_map<int, int> dense_index(const std::unordered_map<int, Agent> & side) {
+    std::vector<int> ids;
+    ids.reserve(side.size());
+    for (auto & [key, agent]: side) {
+      ids.push_back(key);
+    }
+    std::sort(ids.begin(), ids.end());
+    std::unordered_map<int, int> index;
+    index.reserve(ids.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+      index[ids[i]] = i;
+    }
+    return index;
+  }
+
   /*
    * Perform one reduction. Returns the number of preferences removed, or -1 if
    * no preferences were removed but a new agent was marked as "always
@@ -21,11 +40,17 @@ int single_reduction(std::unordered_map<int, Agent> & to_preprocess,
                      std::unordered_map<int, Agent> & other_side,
                      std::unordered_set<int> & these_always_allocated,
                      std::unordered_set<int> & other_always_allocated,
+                     const std::unordered_map<int, int> & these_index,
+                     const std::unordered_map<int, int> & other_index,
                      bool supp) {
+  SMTI_TIME("single_reduction");
   int num_removed = 0;
   bool new_always_allocated = false;
+  // Vertices on the left of the graph are agents from to_preprocess, and on
+  // the right from other_side, named by their dense indices.
+  Graph g(these_index.size(), other_index.size());
   for (auto & [key, agent]: to_preprocess) {
-    Graph g;
+    g.clear();
     int n_1 = 0;
     for (unsigned int rank = 0; rank < agent.preferences().size(); ++rank) {
       auto &pref_tie = agent.preference_group(rank);
@@ -37,7 +62,8 @@ int single_reduction(std::unordered_map<int, Agent> & to_preprocess,
         continue;
       }
       for (auto position: pref_tie) {
-        g.addVertex(1, position);
+        int right = other_index.at(position);
+        g.addVertex(1, right);
         Agent &other = other_side.at(position);
         for (int l = 0; l <= other.rank_of(agent.id()); l++) {
           for (size_t k = 0; k < other.preferences()[l].size(); k++) {
@@ -45,11 +71,12 @@ int single_reduction(std::unordered_map<int, Agent> & to_preprocess,
             if (other_cand == agent.id()) { // Don't add the current candidate to the graph
               continue;
             }
-            if (!g.containsVertex(0, other_cand)) {
-              g.addVertex(0, other_cand);
+            int left = these_index.at(other_cand);
+            if (!g.containsVertex(0, left)) {
+              g.addVertex(0, left);
               n_1 += 1;
             }
-            g.addEdge(position, other_cand);
+            g.addEdge(right, left);
           }
         }
       }
@@ -59,7 +86,7 @@ int single_reduction(std::unordered_map<int, Agent> & to_preprocess,
       bool matching_cant_exist = (2 * n_1 + 1 <= g.size());
       if (!matching_cant_exist) {
         for (auto position : agent.preference_group(rank)) {
-          g.augment(position);
+          g.augment(other_index.at(position));
         }
       }
       // Add P' in this, which we only do on the first iteration (rank == 0)
@@ -74,17 +101,19 @@ int single_reduction(std::unordered_map<int, Agent> & to_preprocess,
           // If position is acceptable to i, then skip it.
           if (other_side.at(position).is_compatible(agent))
             continue;
-          g.addVertex(1, position);
+          int right = other_index.at(position);
+          g.addVertex(1, right);
           for (auto &group : other_side.at(position).preferences()) {
             for (auto candidate : group) {
-              if (!g.containsVertex(0, candidate)) {
-                g.addVertex(0, candidate);
+              int left = these_index.at(candidate);
+              if (!g.containsVertex(0, left)) {
+                g.addVertex(0, left);
                 n_1 += 1;
               }
-              g.addEdge(position, candidate);
+              g.addEdge(right, left);
             }
           }
-          g.augment(position);
+          g.augment(right);
         }
         // I'm using a while loop as an if statement, so I need to break out.
         break;
@@ -115,13 +144,20 @@ int single_reduction(std::unordered_map<int, Agent> & to_preprocess,
 }
 
 void SMTI::preprocess(PreprocessMode mode) {
+  SMTI_TIME("preprocess");
+  _grp.reset();
   std::unordered_set<int> left_always_assigned, right_always_assigned;
+  // Agents are never removed here, only preferences, so the indices hold
+  // for every reduction.
+  std::unordered_map<int, int> left_index = dense_index(_ones);
+  std::unordered_map<int, int> right_index = dense_index(_twos);
   bool keep_going = true;
   while (keep_going) {
     keep_going = false;
     int removed = single_reduction(_ones, _twos,
                                   left_always_assigned,
                                   right_always_assigned,
+                                  left_index, right_index,
                                   mode == Complete);
     if (removed == -1) {
       keep_going = true;
@@ -130,12 +166,14 @@ void SMTI::preprocess(PreprocessMode mode) {
     int right = single_reduction(_twos, _ones,
                                  right_always_assigned,
                                  left_always_assigned,
+                                 right_index, left_index,
                                  mode == Complete);
     if (right == -1) {
       keep_going = true;
       right = 0;
     }
     removed += right;
+    SMTI_COUNT("preprocess_removed", removed);
     if (removed > 0) {
       keep_going = true;
     }
@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <climits>
+
+#include "Stats.h"
+#include "smti.h"
+
+namespace {
+  // One side of the instance with agents indexed densely in order of ID,
+  // and preference lists stored as flat arrays (CSR): the preferences of
+  // agent i are entries start[i] to start[i+1]-1, in order of rank.
+  struct Side {
+    std::vector<int> ids;
+    std::unordered_map<int, int> index;
+    std::vector<int> start;
+    std::vector<int> partner;  // Index on the other side, or -1.
+    // Index on the other side, or the number of agents there if the ID is
+    // unknown, so that arrays over the other side with one extra entry can
+    // be indexed without a test.
+    std::vector<int> other;
+    std::vector<int> rank;
+
+    Side(const std::unordered_map<int, Agent> & agents) {
+      ids.reserve(agents.size());
+      for(auto & [id, agent]: agents) {
+        ids.push_back(id);
+      }
+      std::sort(ids.begin(), ids.end());
+      index.reserve(ids.size());
+      for(size_t i = 0; i < ids.size(); ++i) {
+        index[ids[i]] = i;
+      }
+      start.reserve(ids.size() + 1);
+      partner.assign(ids.size(), -1);
+    }
+
+    void build(const std::unordered_map<int, Agent> & agents, const Side & other_side) {
+      for(int id: ids) {
+        start.push_back(other.size());
+        const std::vector<std::vector<int>> & preferences = agents.at(id).preferences();
+        for(size_t group = 0; group < preferences.size(); ++group) {
+          for(int pref: preferences[group]) {
+            auto found = other_side.index.find(pref);
+            other.push_back((found == other_side.index.end()) ? other_side.ids.size() : found->second);
+            rank.push_back(group);
+          }
+        }
+      }
+      start.push_back(other.size());
+    }
+
+    // The rank given by agent i to agent j on the other side, or INT_MAX if
+    // j is not on its list.
+    int rank_of(int i, int j) const {
+      for(int entry = start[i]; entry < start[i + 1]; ++entry) {
+        if (other[entry] == j) {
+          return rank[entry];
+        }
+      }
+      return INT_MAX;
+    }
+  };
+} // namespace
+
+SMTI::StabilityReport SMTI::check_stability(const Matching & matching) const {
+  SMTI_TIME("check_stability");
+  Side left(_ones), right(_twos);
+  left.build(_ones, right);
+  right.build(_twos, left);
+  int num_left = left.ids.size();
+  int num_right = right.ids.size();
+  StabilityReport report;
+
+  // The dense partner arrays. Agents in more than one pair keep the first
+  // pair in which both agents are still free.
+  std::vector<int> left_pairs(num_left, 0);
+  std::vector<int> right_pairs(num_right, 0);
+  for(auto [one, two]: matching) {
+    auto i = left.index.find(one);
+    auto j = right.index.find(two);
+    if ((i == left.index.end()) || (j == right.index.end())) {
+      report.unacceptable_pairs.emplace_back(one, two);
+      continue;
+    }
+    bool left_free = (left_pairs[i->second]++ == 0);
+    bool right_free = (right_pairs[j->second]++ == 0);
+    if (left_free && right_free) {
+      left.partner[i->second] = j->second;
+      right.partner[j->second] = i->second;
+    }
+  }
+  for(int i = 0; i < num_left; ++i) {
+    if (left_pairs[i] > 1) {
+      report.left_over_capacity.push_back(left.ids[i]);
+    }
+  }
+  for(int j = 0; j < num_right; ++j) {
+    if (right_pairs[j] > 1) {
+      report.right_over_capacity.push_back(right.ids[j]);
+    }
+  }
+
+  // The rank each agent gives its partner, or INT_MAX if it has none, so
+  // that an agent is improved on by anyone with a lower rank.
+  std::vector<int> left_partner_rank(num_left, INT_MAX);
+  std::vector<int> right_partner_rank(num_right + 1, INT_MAX);
+  for(int i = 0; i < num_left; ++i) {
+    int j = left.partner[i];
+    if (j == -1) {
+      continue;
+    }
+    left_partner_rank[i] = left.rank_of(i, j);
+    right_partner_rank[j] = right.rank_of(j, i);
+    if ((left_partner_rank[i] == INT_MAX) || (right_partner_rank[j] == INT_MAX)) {
+      report.unacceptable_pairs.emplace_back(left.ids[i], right.ids[j]);
+    }
+  }
+
+  // For every entry on the left, the rank that the agent on the right gives
+  // back, or INT_MAX if it does not list the agent on the left or is
+  // unknown. The lists of the right are bucketed by left agent, and each
+  // left agent scatters the positions of its entries to match them up, so
+  // this takes time linear in the lists.
+  std::vector<int> rank_back(left.other.size(), INT_MAX);
+  std::vector<int> by_left_start(num_left + 1, 0);
+  for(int i: right.other) {
+    if (i != num_left) {
+      by_left_start[i + 1]++;
+    }
+  }
+  for(int i = 0; i < num_left; ++i) {
+    by_left_start[i + 1] += by_left_start[i];
+  }
+  std::vector<int> by_left_right(by_left_start.back());
+  std::vector<int> by_left_rank(by_left_start.back());
+  std::vector<int> fill(by_left_start.begin(), by_left_start.end() - 1);
+  for(int j = 0; j < num_right; ++j) {
+    for(int entry = right.start[j]; entry < right.start[j + 1]; ++entry) {
+      int i = right.other[entry];
+      if (i != num_left) {
+        by_left_right[fill[i]] = j;
+        by_left_rank[fill[i]++] = right.rank[entry];
+      }
+    }
+  }
+  std::vector<int> position(num_right + 1, -1);
+  for(int i = 0; i < num_left; ++i) {
+    for(int entry = left.start[i]; entry < left.start[i + 1]; ++entry) {
+      position[left.other[entry]] = entry;
+    }
+    for(int k = by_left_start[i]; k < by_left_start[i + 1]; ++k) {
+      if (position[by_left_right[k]] != -1) {
+        rank_back[position[by_left_right[k]]] = by_left_rank[k];
+      }
+    }
+    for(int entry = left.start[i]; entry < left.start[i + 1]; ++entry) {
+      position[left.other[entry]] = -1;
+    }
+  }
+
+  // A pair blocks if the left agent ranks the right strictly above its
+  // partner, which is a prefix of its list, and the right agent ranks the
+  // left strictly above its partner. The second test is a single
+  // comparison over flat arrays, as unknown agents and missing entries have
+  // rank INT_MAX, so the loop has no other branches.
+  for(int i = 0; i < num_left; ++i) {
+    int end = left.start[i];
+    while ((end < left.start[i + 1]) && (left.rank[end] < left_partner_rank[i])) {
+      ++end;
+    }
+    for(int entry = left.start[i]; entry < end; ++entry) {
+      if (rank_back[entry] < right_partner_rank[left.other[entry]]) {
+        report.blocking_pairs.emplace_back(left.ids[i], right.ids[left.other[entry]]);
+      }
+    }
+  }
+
+  // Agents left unmatched although someone would accept them.
+  std::vector<bool> right_acceptable(num_right + 1, false);
+  for(int i = 0; i < num_left; ++i) {
+    bool acceptable = false;
+    for(int entry = left.start[i]; entry < left.start[i + 1]; ++entry) {
+      if (rank_back[entry] != INT_MAX) {
+        acceptable = true;
+        right_acceptable[left.other[entry]] = true;
+      }
+    }
+    if (acceptable && (left.partner[i] == -1)) {
+      report.left_unmatched.push_back(left.ids[i]);
+    }
+  }
+  for(int j = 0; j < num_right; ++j) {
+    if (right_acceptable[j] && (right.partner[j] == -1)) {
+      report.right_unmatched.push_back(right.ids[j]);
+    }
+  }
+  return report;
+}
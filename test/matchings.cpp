@@ -1,5 +1,6 @@
 #include "catch.hpp"
 #include "matching.h"
+#include "smti.h"
 #include <iostream>
 
 TEST_CASE( "Test equality", "[Matching]") {
@@ -14,3 +15,35 @@ TEST_CASE( "Test equality", "[Matching]") {
   REQUIRE( three == four );
 }
 
+
+TEST_CASE( "Check stability of matchings", "[Matching]") {
+  SMTI instance("test-ties.instance");
+  REQUIRE( instance.check_stability({{1, 1}, {2, 2}, {3, 3}, {4, 4}}).stable() );
+
+  // Everyone gets a second choice, and (1, 1) prefer each other.
+  SMTI::StabilityReport swapped = instance.check_stability({{1, 3}, {2, 4}, {3, 1}, {4, 2}});
+  REQUIRE_FALSE( swapped.stable() );
+  REQUIRE( swapped.blocking_pairs.has({1, 1}) );
+  REQUIRE( swapped.blocking_pairs.size() == 8 );
+
+  SMTI::StabilityReport partial = instance.check_stability({{1, 1}, {2, 2}, {3, 3}});
+  REQUIRE( partial.blocking_pairs == Matching{{4, 4}} );
+  REQUIRE( partial.left_unmatched == std::vector<int>{4} );
+  REQUIRE( partial.right_unmatched == std::vector<int>{4} );
+
+  SMTI::StabilityReport invalid = instance.check_stability({{1, 1}, {1, 2}, {5, 3}, {2, 2}});
+  REQUIRE( invalid.left_over_capacity == std::vector<int>{1} );
+  REQUIRE( invalid.right_over_capacity == std::vector<int>{2} );
+  REQUIRE( invalid.unacceptable_pairs == Matching{{5, 3}} );
+
+  // Gale-Shapley always gives a stable matching, and taking a pair out of
+  // one leaves the pair blocking.
+  SMTI generated(300, 10, 0.3, uint64_t(5));
+  std::mt19937 generator(1);
+  Matching matching = generated.gale_shapley(generator);
+  REQUIRE( generated.check_stability(matching).stable() );
+  std::pair<int, int> removed = matching.front();
+  matching.pop_front();
+  SMTI::StabilityReport report = generated.check_stability(matching);
+  REQUIRE( report.blocking_pairs.has(removed) );
+}
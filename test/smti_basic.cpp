@@ -1,5 +1,9 @@
 #include "catch.hpp"
+#include "InstanceGenerator.h"
+#include "InstanceView.h"
 #include "smti.h"
+#include <filesystem>
+#include <fstream>
 
 TEST_CASE( "Test removing a pair.", "[basic]" ) {
   SMTI instance("test-tiny.instance");
@@ -42,3 +46,263 @@ TEST_CASE( "Test removing multiple preferences", "[basic]" ) {
   std::cout << a.pref_list_string() << std::endl;
   REQUIRE( a.num_prefs() == 2 );
 }
+
+TEST_CASE( "Read instances in plain and capacity formats", "[basic]" ) {
+  std::filesystem::path filename = std::filesystem::temp_directory_path() / "smti-read-test.instance";
+  {
+    std::ofstream out(filename);
+    out << "0\n2\n2\n1: 1 2\n\n2: [1 2]\n1: 1: 2 1\n2 : 1 ( 1 2 )\n";
+  }
+  SMTI capacity(filename.string());
+  REQUIRE( capacity.num_agents_left() == 2 );
+  REQUIRE( capacity.num_agents_right() == 2 );
+  REQUIRE( capacity.agent_left(1).preferences().size() == 2 );
+  REQUIRE( capacity.agent_left(2).preferences().size() == 1 );
+  REQUIRE( capacity.agent_right(1).preferences().size() == 2 );
+  REQUIRE( capacity.agent_right(1).rank_of(2) == 0 );
+  REQUIRE( capacity.agent_right(2).preferences().size() == 1 );
+
+  SMTI instance("test-ties.instance");
+  {
+    std::ofstream out(filename);
+    out << instance.to_string();
+  }
+  SMTI reread(filename.string());
+  for(int id = 1; id <= 4; ++id) {
+    REQUIRE( reread.agent_left(id).pref_list_string() == instance.agent_left(id).pref_list_string() );
+    REQUIRE( reread.agent_right(id).pref_list_string() == instance.agent_right(id).pref_list_string() );
+  }
+
+  {
+    std::ofstream out(filename);
+    out << "1\n1\n1: [1\n1: 1\n";
+  }
+  REQUIRE_THROWS_AS( SMTI(filename.string()), std::invalid_argument );
+  std::filesystem::remove(filename);
+  REQUIRE_THROWS_AS( SMTI(filename.string()), std::system_error );
+}
+
+TEST_CASE( "Save and load instances in binary", "[basic]" ) {
+  std::filesystem::path filename = std::filesystem::temp_directory_path() / "smti-binary-test.bin";
+  SMTI instance = SMTI::create_from_GRP("grp-test-medium.instance");
+  instance.save_binary(filename.string());
+  SMTI loaded = SMTI::load_binary(filename.string());
+  REQUIRE( loaded.num_agents_left() == instance.num_agents_left() );
+  REQUIRE( loaded.num_agents_right() == instance.num_agents_right() );
+  for(auto & [id, agent]: instance.agents_left()) {
+    REQUIRE( loaded.agent_left(id).pref_list_string() == agent.pref_list_string() );
+  }
+  for(auto & [id, agent]: instance.agents_right()) {
+    REQUIRE( loaded.agent_right(id).pref_list_string() == agent.pref_list_string() );
+  }
+
+  InstanceView view(filename.string());
+  REQUIRE( view.verify() );
+  REQUIRE( view.num_agents_left() == (size_t)instance.num_agents_left() );
+  for(size_t index = 0; index < view.num_agents_left(); ++index) {
+    const Agent & agent = instance.agent_left(view.left_id(index));
+    REQUIRE( view.left_index(agent.id()) == (long)index );
+    REQUIRE( view.num_groups_left(index) == agent.preferences().size() );
+    REQUIRE( view.prefs_left(index).size() == (size_t)agent.num_prefs() );
+  }
+  REQUIRE( view.left_index(-5) == -1 );
+
+  // Flip one byte of the preferences.
+  {
+    std::fstream file(filename, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(-4, std::ios::end);
+    file.put(0x7f);
+  }
+  REQUIRE_FALSE( InstanceView(filename.string()).verify() );
+  REQUIRE_THROWS_AS( SMTI::load_binary(filename.string()), std::invalid_argument );
+  REQUIRE_THROWS_AS( InstanceView("test-ties.instance"), std::invalid_argument );
+
+  // Point the tie groups of the second agent far past the end of the file,
+  // which the checksum alone would only catch in load_binary().
+  instance.save_binary(filename.string());
+  {
+    uint64_t num_agents = instance.num_agents_left() + instance.num_agents_right();
+    std::fstream file(filename, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(sizeof(BinaryInstanceHeader) + (num_agents * sizeof(int32_t) + 7) / 8 * 8 + sizeof(int64_t));
+    int64_t offset = int64_t(1) << 40;
+    file.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+  }
+  REQUIRE_THROWS_AS( InstanceView(filename.string()), std::invalid_argument );
+  REQUIRE_THROWS_AS( SMTI::load_binary(filename.string()), std::invalid_argument );
+  std::filesystem::remove(filename);
+}
+
+TEST_CASE( "Read instances with several threads", "[basic]" ) {
+  std::filesystem::path filename = std::filesystem::temp_directory_path() / "smti-parallel-test.instance";
+  std::mt19937 generator(3);
+  SMTI instance(200, 10, 0.4, generator);
+  {
+    std::ofstream out(filename);
+    out << instance.to_string();
+  }
+  SMTI sequential(filename.string());
+  for(int threads: {1, 2, 7, 64}) {
+    SMTI parallel(filename.string(), threads);
+    REQUIRE( parallel.to_string() == sequential.to_string() );
+  }
+  {
+    std::ofstream out(filename);
+    out << "0\n2\n2\n1: 1 2\n\n2: [1 2]\n1: 1: 2 1\n2 : 1 ( 1 2 )\n";
+  }
+  REQUIRE( SMTI(filename.string(), 3).to_string() == SMTI(filename.string()).to_string() );
+  {
+    std::ofstream out(filename);
+    out << "2\n2\n1: 1 2\n2: 1\n1: 1 2\n";
+  }
+  REQUIRE_THROWS_AS( SMTI(filename.string(), 2), std::invalid_argument );
+  std::filesystem::remove(filename);
+}
+
+TEST_CASE( "Generate instances from a seed with several threads", "[basic]" ) {
+  SMTI instance(300, 12, 0.3, 5, 1);
+  REQUIRE( instance.num_agents_left() == 300 );
+  REQUIRE( instance.num_agents_right() == 300 );
+  for(int threads: {2, 7, 0}) {
+    SMTI parallel(300, 12, 0.3, 5, threads);
+    REQUIRE( parallel.to_string() == instance.to_string() );
+  }
+  REQUIRE( SMTI(300, 12, 0.3, 6, 1).to_string() != instance.to_string() );
+  for(int i = 1; i <= 300; ++i) {
+    std::vector<int> prefs = instance.agent_left(i).prefs();
+    REQUIRE( prefs.size() == 12 );
+    std::sort(prefs.begin(), prefs.end());
+    REQUIRE( std::adjacent_find(prefs.begin(), prefs.end()) == prefs.end() );
+    for(int j: prefs) {
+      REQUIRE( j >= 1 );
+      REQUIRE( j <= 300 );
+      REQUIRE( instance.agent_right(j).is_compatible(instance.agent_left(i)) );
+    }
+  }
+  // Lists longer than the number of agents are cut short.
+  SMTI small(5, 10, 0.5, 1);
+  REQUIRE( small.agent_left(1).num_prefs() == 5 );
+  REQUIRE( small.agent_right(1).num_prefs() == 5 );
+}
+
+TEST_CASE( "Stream generated instances to text and binary files", "[basic]" ) {
+  std::filesystem::path text = std::filesystem::temp_directory_path() / "smti-stream-test.instance";
+  std::filesystem::path binary = std::filesystem::temp_directory_path() / "smti-stream-test.bin";
+  InstanceGenerator generator(150, 8, 0.3, 11);
+  SMTI instance(150, 8, 0.3, 11);
+  // A small limit splits the right agents into many batches.
+  for(size_t memory_limit: {(size_t)64, (size_t)1000, InstanceGenerator::default_memory_limit}) {
+    generator.write_text(text.string(), memory_limit);
+    generator.write_binary(binary.string(), memory_limit);
+    REQUIRE( InstanceView(binary.string()).verify() );
+    for(SMTI streamed: {SMTI(text.string()), SMTI::load_binary(binary.string())}) {
+      REQUIRE( streamed.num_agents_left() == 150 );
+      REQUIRE( streamed.num_agents_right() == 150 );
+      for(int id = 1; id <= 150; ++id) {
+        REQUIRE( streamed.agent_left(id).preferences() == instance.agent_left(id).preferences() );
+        REQUIRE( streamed.agent_right(id).preferences() == instance.agent_right(id).preferences() );
+      }
+    }
+  }
+  std::filesystem::remove(text);
+  std::filesystem::remove(binary);
+}
+
+TEST_CASE( "Generate structured families of instances", "[basic]" ) {
+  using Family = InstanceGenerator::Family;
+  for(Family family: {Family::MasterList, Family::Euclidean, Family::Popularity, Family::GRP}) {
+    InstanceGenerator::Shape shape;
+    shape.family = family;
+    shape.tie_width = 0.05;
+    InstanceGenerator generator(200, 10, shape, 3);
+    SMTI instance(generator);
+    REQUIRE( SMTI(generator, 3).to_string() == instance.to_string() );
+    for(int i = 1; i <= 200; ++i) {
+      REQUIRE( instance.agent_left(i).num_prefs() == 10 );
+      for(int j: instance.agent_left(i).prefs()) {
+        REQUIRE( instance.agent_right(j).is_compatible(instance.agent_left(i)) );
+      }
+    }
+    shape.tie_width = 1;
+    SMTI tied(InstanceGenerator(200, 10, shape, 3));
+    REQUIRE( tied.agent_left(1).preferences().size() == 1 );
+  }
+
+  // Without noise, all agents follow the master list of the other side.
+  InstanceGenerator::Shape master;
+  master.family = Family::MasterList;
+  SMTI instance(InstanceGenerator(200, 10, master, 4));
+  std::set<std::pair<int, int>> before;
+  for(int i = 1; i <= 200; ++i) {
+    std::vector<int> prefs = instance.agent_left(i).prefs();
+    for(size_t k = 0; k + 1 < prefs.size(); ++k) {
+      before.emplace(prefs[k], prefs[k + 1]);
+    }
+  }
+  for(auto [first, second]: before) {
+    REQUIRE( before.count({second, first}) == 0 );
+  }
+
+  InstanceGenerator::Shape popularity;
+  popularity.family = Family::Popularity;
+  SMTI skewed(InstanceGenerator(200, 10, popularity, 5));
+  REQUIRE( skewed.agent_right(1).num_prefs() > skewed.agent_right(200).num_prefs() );
+}
+
+TEST_CASE( "Account for memory and enforce a budget", "[basic]" ) {
+  SMTI instance("test-ties.instance");
+  SMTI::MemoryUsage before = instance.memory_usage();
+  REQUIRE( before.preferences > 0 );
+  REQUIRE( before.encoding == 0 );
+  std::string encoding = instance.encodeSAT();
+  SMTI::MemoryUsage after = instance.memory_usage();
+  REQUIRE( after.variable_maps > before.variable_maps );
+  REQUIRE( after.encoding >= encoding.size() );
+
+  // A generous budget changes nothing, a tiny one stops the encoders and
+  // the IP model early.
+  instance.memory_budget(1 << 30);
+  REQUIRE( instance.encodeSAT() == encoding );
+  instance.memory_budget(after.preferences + after.variable_maps + 100);
+  REQUIRE_THROWS_AS( instance.encodeSAT(), MemoryBudgetExceeded );
+  REQUIRE_THROWS_AS( instance.encodePBO2(true), MemoryBudgetExceeded );
+  REQUIRE_THROWS_AS( instance.encodeMZN(), MemoryBudgetExceeded );
+  SMTI copy(instance);
+  REQUIRE( copy.memory_budget() == instance.memory_budget() );
+  // The IP model is checked against the budget before it is built, so
+  // nothing is built or cached.
+  std::filesystem::path directory = std::filesystem::temp_directory_path() / "smti-budget-cache-test";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directory(directory);
+  SMTI::IP_Model model(&instance);
+  model.cache_directory(directory.string());
+  REQUIRE_THROWS_AS( model.solve(), MemoryBudgetExceeded );
+  REQUIRE( model.num_cols() == 0 );
+  REQUIRE( std::filesystem::is_empty(directory) );
+  instance.memory_budget(0);
+  REQUIRE( model.solve().size() > 0 );
+  REQUIRE( model.memory_usage() > 0 );
+  REQUIRE_FALSE( std::filesystem::is_empty(directory) );
+  std::filesystem::remove_all(directory);
+}
+
+TEST_CASE( "Read an instance with labelled agents", "[basic]" ) {
+  SMTI instance = SMTI::load_labelled("test-labelled.instance");
+  REQUIRE( instance.has_labels() );
+  const IdMap<std::string> & left = instance.left_labels();
+  const IdMap<std::string> & right = instance.right_labels();
+  REQUIRE( left.find("alice") == 1 );
+  REQUIRE( left.find("bob") == 2 );
+  REQUIRE( left.find("carol") == -1 );
+  REQUIRE( right.key(1) == "x9000000000" );
+  REQUIRE( right.key(2) == "y" );
+  REQUIRE( instance.agent_left(1).prefs() == std::vector<int>{1, 2} );
+  REQUIRE( instance.agent_left(2).preferences().size() == 1 );
+  REQUIRE( instance.agent_right(1).prefs() == std::vector<int>{2, 1} );
+  REQUIRE( SMTI(instance).has_labels() );
+  REQUIRE_FALSE( SMTI("test-tiny.instance").has_labels() );
+
+  std::filesystem::path filename = std::filesystem::temp_directory_path() / "smti-labelled.instance";
+  std::ofstream(filename) << "1\n1\na: b\nb: c\n";
+  REQUIRE_THROWS_AS( SMTI::load_labelled(filename.string()), std::invalid_argument );
+  std::filesystem::remove(filename);
+}
@@ -1,5 +1,8 @@
 #include "catch.hpp"
+#include "GRP_Scores.h"
 #include "smti.h"
+#include <filesystem>
+#include <fstream>
 
 TEST_CASE( "Read instance in SMTI-GRP format.", "[smti-grp]" ) {
   SMTI grp =  SMTI::create_from_GRP("grp-test-small.instance");
@@ -33,3 +36,88 @@ TEST_CASE( "Read instances in SMTI-GRP format with thresholding.", "[smti-grp]"
   a = grp.agent_left(2);
   REQUIRE( a.num_prefs() == 2);
 }
+
+TEST_CASE( "Read sparse GRP instances, with and without quantisation.", "[smti-grp]" ) {
+  std::filesystem::path filename = std::filesystem::temp_directory_path() / "smti-sparse-grp-test.instance";
+  {
+    std::ofstream out(filename);
+    out << "3\n3\n0 0 5\n0 1 3\n0 2 1\n1 0 3\n1 1 5\n1 2 1\n2 0 1\n2 1 5\n2 2 3\n";
+  }
+  for(int threshold: {0, 2, 4}) {
+    SMTI sparse = SMTI::create_from_sparse_GRP(filename.string(), threshold);
+    SMTI dense = SMTI::create_from_GRP("grp-test-small.instance", threshold);
+    REQUIRE( sparse.to_string() == dense.to_string() );
+  }
+  {
+    std::ofstream out(filename);
+    out << "2\n1\n0 0 1.2\n\n1 0 1.7\n";
+  }
+  SMTI exact = SMTI::create_from_sparse_GRP(filename.string());
+  REQUIRE( exact.agent_right(0).preferences().size() == 2 );
+  REQUIRE( exact.agent_right(0).rank_of(1) == 0 );
+  SMTI quantised = SMTI::create_from_sparse_GRP(filename.string(), 0, 1);
+  REQUIRE( quantised.agent_right(0).preferences().size() == 1 );
+  REQUIRE( quantised.agent_right(0).num_prefs() == 2 );
+  {
+    std::ofstream out(filename);
+    out << "2\n1\n0 1 1.2\n";
+  }
+  REQUIRE_THROWS_AS( SMTI::create_from_sparse_GRP(filename.string()), std::invalid_argument );
+  std::filesystem::remove(filename);
+}
+
+TEST_CASE( "Build GRP instances at several thresholds from one read.", "[smti-grp]" ) {
+  GRP_Scores scores("grp-test-small.instance");
+  REQUIRE( scores.num_rows() == 3 );
+  REQUIRE( scores.num_cols() == 3 );
+  REQUIRE( scores.num_pairs() == 9 );
+  for(int threshold: {6, 4, 2, 0}) {
+    SMTI family = scores.instance(threshold);
+    SMTI single = SMTI::create_from_GRP("grp-test-small.instance", threshold);
+    REQUIRE( family.to_string() == single.to_string() );
+  }
+  std::filesystem::path filename = std::filesystem::temp_directory_path() / "smti-grp-family-test.instance";
+  {
+    std::ofstream out(filename);
+    out << "2\n1\n0 0 1.7\n1 0 1.2\n";
+  }
+  // With quantisation, a threshold may fall inside a tie.
+  GRP_Scores quantised(filename.string(), true, 1, 1.5);
+  REQUIRE( quantised.num_pairs() == 1 );
+  REQUIRE( quantised.instance(1.5).agent_right(0).num_prefs() == 1 );
+  REQUIRE( quantised.instance(1.8).agent_right(0).num_prefs() == 0 );
+  quantised = GRP_Scores(filename.string(), true, 1);
+  REQUIRE( quantised.instance(1.5).agent_right(0).num_prefs() == 1 );
+  REQUIRE( quantised.instance(1).agent_right(0).preferences().size() == 1 );
+  REQUIRE( quantised.instance(1).agent_right(0).num_prefs() == 2 );
+  std::filesystem::remove(filename);
+}
+
+TEST_CASE( "Solve GRP instances through the global order of pairs.", "[smti-grp]" ) {
+  SMTI instance = SMTI::create_from_GRP("grp-test-medium.instance");
+  REQUIRE( instance.is_GRP() );
+  SMTI::IP_Model model(&instance);
+  Matching generic = model.solve();
+  // Forced pairs are in every stable matching.
+  for(auto & pair: instance.GRP_forced_pairs()) {
+    REQUIRE( generic.has(pair) );
+  }
+  REQUIRE( instance.solve_GRP().size() == generic.size() );
+  SMTI copy(instance);
+  REQUIRE( copy.is_GRP() );
+  copy.remove_pair(0, 0);
+  REQUIRE( !copy.is_GRP() );
+  REQUIRE_THROWS_AS( copy.GRP_forced_pairs(), std::logic_error );
+
+  // Without ties, the only stable matching comes from the order alone.
+  std::filesystem::path filename = std::filesystem::temp_directory_path() / "smti-grp-solve-test.instance";
+  {
+    std::ofstream out(filename);
+    out << "3\n3\n0 0 6\n0 1 8\n1 1 9\n1 2 3\n2 0 7\n2 2 1\n";
+  }
+  SMTI strict = SMTI::create_from_sparse_GRP(filename.string());
+  Matching forced = strict.GRP_forced_pairs();
+  REQUIRE( forced == Matching({{1, 1}, {2, 0}}) );
+  REQUIRE( strict.solve_GRP() == forced );
+  std::filesystem::remove(filename);
+}
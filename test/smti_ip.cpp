@@ -1,6 +1,10 @@
 #include "catch.hpp"
 #include "smti.h"
+#include <OsiSymSolverInterface.hpp>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <thread>
 
 TEST_CASE( "Solve instance with ties, no merged constraints", "[IP]") {
   SMTI instance("test-ties.instance");
@@ -156,3 +160,314 @@ TEST_CASE( "Count stable matchings in instance with ties ", "[IP]") {
   std::list<Matching> matchings = model.find_all_stable_matchings();
   REQUIRE( matchings.size() == 4 );
 }
+
+TEST_CASE( "Count stable matchings in parallel", "[IP]") {
+  SMTI instance("test-ties.instance");
+  SMTI::IP_Model model = SMTI::IP_Model(&instance);
+  std::list<Matching> sequential = model.find_all_stable_matchings();
+  for(int threads: {1, 3}) {
+    SMTI::IP_Model parallel = SMTI::IP_Model(&instance);
+    std::list<Matching> matchings = parallel.find_all_stable_matchings(threads);
+    REQUIRE( matchings.size() == 4 );
+    for(const Matching & matching: matchings) {
+      REQUIRE( std::count(sequential.begin(), sequential.end(), matching) == 1 );
+    }
+  }
+  // The workers share one base model, so only one cache entry is written,
+  // and a second run reads it back.
+  std::filesystem::path directory = std::filesystem::temp_directory_path() / "smti-ip-parallel-cache-test";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directory(directory);
+  for(int run = 0; run < 2; ++run) {
+    SMTI::IP_Model parallel = SMTI::IP_Model(&instance);
+    parallel.cache_directory(directory.string());
+    REQUIRE( parallel.find_all_stable_matchings(3).size() == 4 );
+    int files = std::distance(std::filesystem::directory_iterator(directory),
+                              std::filesystem::directory_iterator());
+    REQUIRE( files == 1 );
+  }
+  std::filesystem::remove_all(directory);
+}
+
+TEST_CASE( "Reuse a model with different forced pairings", "[IP]") {
+  SMTI instance("test-ties.instance");
+  SMTI::IP_Model model = SMTI::IP_Model(&instance);
+  Matching forced{ {1, 2}, {3, 4} };
+  model.force(forced);
+  Matching matching = model.solve();
+  REQUIRE( matching.size() == 4 );
+  REQUIRE( matching.has({1, 2}) );
+  REQUIRE( matching.has({3, 4}) );
+  model.clear_forces_avoids();
+  Matching other{ {1, 1}, {3, 3} };
+  model.force(other);
+  matching = model.solve();
+  REQUIRE( matching.size() == 4 );
+  REQUIRE( matching.has({1, 1}) );
+  REQUIRE( matching.has({3, 3}) );
+}
+
+TEST_CASE( "Forcing conflicting pairings finds nothing", "[IP]") {
+  SMTI instance("test-ties.instance");
+  SMTI::IP_Model model = SMTI::IP_Model(&instance);
+  Matching forced{ {1, 2}, {1, 1} };
+  model.force(forced);
+  Matching matching = model.solve();
+  REQUIRE( matching.size() == 0 );
+}
+
+TEST_CASE( "Solve medium GRP instance with lazy constraints", "[IP]") {
+  SMTI instance =  SMTI::create_from_GRP("grp-test-medium.instance");
+  SMTI::IP_Model model = SMTI::IP_Model(&instance);
+  model.lazy(true);
+  Matching matching = model.solve();
+  REQUIRE( matching.size() == 10 );
+  SMTI::IP_Model single = SMTI::IP_Model(&instance);
+  single.merge(false);
+  single.lazy(true);
+  matching = single.solve();
+  REQUIRE( matching.size() == 10 );
+}
+
+TEST_CASE( "Stop a lazy model early", "[IP]") {
+  SMTI instance =  SMTI::create_from_GRP("grp-test-medium.instance");
+  std::filesystem::path mps = std::filesystem::temp_directory_path() / "smti-lazy-stop-test.mps";
+  SMTI::IP_Model fresh = SMTI::IP_Model(&instance);
+  fresh.lazy(true);
+  fresh.write_mps(mps.string());
+  std::filesystem::remove(mps);
+  for(bool heuristic: {false, true}) {
+    SMTI::IP_Model model = SMTI::IP_Model(&instance);
+    model.lazy(true);
+    model.heuristic_start(heuristic);
+    CancelToken token;
+    model.cancel_token(token);
+    token.cancel();
+    SMTI::IP_Model::Result result = model.solve_detailed();
+    REQUIRE( result.status == SMTI::IP_Model::Cancelled );
+    // Only a stable matching is returned, and checking the incumbent added
+    // nothing to the model.
+    REQUIRE( (result.matching.empty() || instance.check_stability(result.matching).stable()) );
+    REQUIRE( model.num_rows() == fresh.num_rows() );
+  }
+}
+
+TEST_CASE( "Count stable matchings with lazy constraints", "[IP]") {
+  SMTI instance("test-ties.instance");
+  SMTI::IP_Model model = SMTI::IP_Model(&instance);
+  model.lazy(true);
+  std::list<Matching> matchings = model.find_all_stable_matchings();
+  REQUIRE( matchings.size() == 4 );
+}
+
+TEST_CASE( "Solve medium GRP instance with a warm start", "[IP]") {
+  SMTI instance =  SMTI::create_from_GRP("grp-test-medium.instance");
+  std::mt19937 generator(1);
+  Matching start = instance.gale_shapley(generator);
+  REQUIRE( start.size() > 0 );
+  REQUIRE( start.size() <= 10 );
+  SMTI::IP_Model model = SMTI::IP_Model(&instance);
+  model.warm_start(start);
+  Matching matching = model.solve();
+  REQUIRE( matching.size() == 10 );
+  SMTI::IP_Model heuristic = SMTI::IP_Model(&instance);
+  heuristic.heuristic_start(true);
+  matching = heuristic.solve();
+  REQUIRE( matching.size() == 10 );
+}
+
+TEST_CASE( "Count stable matchings with a warm start", "[IP]") {
+  SMTI instance("test-ties.instance");
+  SMTI::IP_Model model = SMTI::IP_Model(&instance);
+  model.heuristic_start(true);
+  std::list<Matching> matchings = model.find_all_stable_matchings();
+  REQUIRE( matchings.size() == 4 );
+}
+
+TEST_CASE( "Solve with a backend chosen at runtime", "[IP]") {
+  std::vector<std::string> names = IP_Backend::available();
+  REQUIRE( std::find(names.begin(), names.end(), "symphony") != names.end() );
+  IP_Backend::register_backend("generic", []() {
+    return IP_Backend::wrap("generic", std::make_unique<OsiSymSolverInterface>());
+  });
+  SMTI instance =  SMTI::create_from_GRP("grp-test-medium.instance");
+  SMTI::IP_Model model = SMTI::IP_Model(&instance);
+  model.backend("generic");
+  IP_Options options;
+  options.time_limit = 60;
+  model.options(options);
+  // The generic backend applies the cutoff from the warm start as a row.
+  model.heuristic_start(true);
+  Matching matching = model.solve();
+  REQUIRE( matching.size() == 10 );
+  REQUIRE_THROWS_AS( model.backend("no-such-solver"), std::invalid_argument );
+}
+
+TEST_CASE( "Solve and report the status", "[IP]") {
+  SMTI instance =  SMTI::create_from_GRP("grp-test-medium.instance");
+  SMTI::IP_Model model = SMTI::IP_Model(&instance);
+  int reports = 0;
+  model.progress([&reports](const IP_Progress & progress) { reports++; });
+  SMTI::IP_Model::Result result = model.solve_detailed();
+  REQUIRE( result.status == SMTI::IP_Model::Optimal );
+  REQUIRE( result.matching.size() == 10 );
+  REQUIRE( result.bound == 10 );
+  REQUIRE( reports > 0 );
+
+  Matching forced{ {0, 1}, {1, 1} };
+  model.force(forced);
+  result = model.solve_detailed();
+  REQUIRE( result.status == SMTI::IP_Model::Infeasible );
+  REQUIRE( result.matching.empty() );
+}
+
+TEST_CASE( "Cancelled solve returns the best matching found", "[IP]") {
+  SMTI instance =  SMTI::create_from_GRP("grp-test-medium.instance");
+  SMTI::IP_Model model = SMTI::IP_Model(&instance);
+  model.heuristic_start(true);
+  CancelToken token;
+  model.cancel_token(token);
+  token.cancel();
+  SMTI::IP_Model::Result result = model.solve_detailed();
+  REQUIRE( result.status == SMTI::IP_Model::Cancelled );
+  REQUIRE( result.matching.size() > 0 );
+  REQUIRE( result.bound >= result.matching.size() );
+  // solve() only returns optimal matchings.
+  REQUIRE( model.solve().empty() );
+  token.reset();
+  REQUIRE( model.solve().size() == 10 );
+}
+
+TEST_CASE( "LP bound and reduced cost fixing", "[IP]") {
+  SMTI instance =  SMTI::create_from_GRP("grp-test-medium.instance");
+  SMTI::IP_Model model = SMTI::IP_Model(&instance);
+  REQUIRE( model.lp_bound() >= 10 );
+  REQUIRE( model.may_achieve(10) );
+  REQUIRE_FALSE( model.may_achieve(instance.num_agents_left() + 1) );
+  Matching fixed = model.reduced_cost_fixing(10);
+  Matching result = model.solve();
+  REQUIRE( result.size() == 10 );
+  for(auto pair: fixed) {
+    REQUIRE( std::find(result.begin(), result.end(), pair) == result.end() );
+  }
+}
+
+TEST_CASE( "Export a model and reuse it from the cache", "[IP]") {
+  SMTI instance =  SMTI::create_from_GRP("grp-test-medium.instance");
+  std::filesystem::path directory = std::filesystem::temp_directory_path() / "smti-ip-cache-test";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directory(directory);
+  {
+    SMTI::IP_Model model = SMTI::IP_Model(&instance);
+    model.cache_directory(directory.string());
+    model.write_mps((directory / "model.mps").string());
+    REQUIRE( std::filesystem::file_size(directory / "model.mps") > 0 );
+    REQUIRE( model.solve().size() == 10 );
+  }
+  int files = std::distance(std::filesystem::directory_iterator(directory),
+                            std::filesystem::directory_iterator());
+  REQUIRE( files == 2 );
+  SMTI::IP_Model cached = SMTI::IP_Model(&instance);
+  cached.cache_directory(directory.string());
+  REQUIRE( cached.solve().size() == 10 );
+  Matching forced{ {0, 1}, {1, 1} };
+  cached.force(forced);
+  REQUIRE( cached.solve().empty() );
+  std::filesystem::remove_all(directory);
+}
+
+TEST_CASE( "Write the same cache entry from several threads", "[IP]") {
+  SMTI instance =  SMTI::create_from_GRP("grp-test-medium.instance");
+  std::filesystem::path directory = std::filesystem::temp_directory_path() / "smti-ip-cache-race-test";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directory(directory);
+  std::vector<std::thread> threads;
+  std::vector<size_t> sizes(4);
+  for(size_t thread = 0; thread < sizes.size(); ++thread) {
+    threads.emplace_back([&, thread]() {
+      SMTI::IP_Model model(&instance);
+      model.cache_directory(directory.string());
+      sizes[thread] = model.solve().size();
+    });
+  }
+  for(std::thread & thread: threads) {
+    thread.join();
+  }
+  for(size_t size: sizes) {
+    REQUIRE( size == 10 );
+  }
+  // Only the finished entry is left, and it can be read back.
+  int files = std::distance(std::filesystem::directory_iterator(directory),
+                            std::filesystem::directory_iterator());
+  REQUIRE( files == 1 );
+  SMTI::IP_Model cached(&instance);
+  cached.cache_directory(directory.string());
+  REQUIRE( cached.solve().size() == 10 );
+  std::filesystem::remove_all(directory);
+}
+
+TEST_CASE( "Rebuild the model when the cache entry is damaged", "[IP]") {
+  SMTI instance =  SMTI::create_from_GRP("grp-test-medium.instance");
+  std::filesystem::path directory = std::filesystem::temp_directory_path() / "smti-ip-cache-damage-test";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directory(directory);
+  {
+    SMTI::IP_Model model(&instance);
+    model.cache_directory(directory.string());
+    REQUIRE( model.solve().size() == 10 );
+  }
+  std::filesystem::path entry = std::filesystem::directory_iterator(directory)->path();
+  uintmax_t length = std::filesystem::file_size(entry);
+  // The size of the first array, straight after the magic, key and bound.
+  std::streamoff first_size = 8 + 8 + sizeof(int);
+  // A flipped payload byte, an array claiming more than the file holds, and
+  // a file cut short.
+  std::vector<std::pair<std::streamoff, uint64_t>> damage{
+    {(std::streamoff)length / 2, 0x5a},
+    {first_size, ~uint64_t(0) / 8},
+  };
+  for(auto [offset, value]: damage) {
+    {
+      std::fstream file(entry, std::ios::in | std::ios::out | std::ios::binary);
+      file.seekp(offset);
+      file.write(reinterpret_cast<const char*>(&value), (offset == first_size) ? sizeof(value) : 1);
+    }
+    SMTI::IP_Model model(&instance);
+    model.cache_directory(directory.string());
+    REQUIRE( model.solve().size() == 10 );
+  }
+  std::filesystem::resize_file(entry, length / 2);
+  SMTI::IP_Model model(&instance);
+  model.cache_directory(directory.string());
+  REQUIRE( model.solve().size() == 10 );
+  REQUIRE( std::filesystem::file_size(entry) == length );
+  std::filesystem::remove_all(directory);
+}
+
+TEST_CASE( "Split into components and solve each", "[IP]") {
+  std::filesystem::path filename = std::filesystem::temp_directory_path() / "smti-components.instance";
+  std::ofstream(filename) << "4\n4\n1: 1 [2 3]\n2: 2 1\n3: 4\n4:\n"
+                          << "1: 2 1\n2: 1 2\n3: 1\n4: 3\n";
+  SMTI instance(filename.string());
+  std::filesystem::remove(filename);
+  std::vector<SMTI> parts = instance.components();
+  REQUIRE( parts.size() == 2 );
+  REQUIRE( parts[0].num_agents_left() == 2 );
+  REQUIRE( parts[0].num_agents_right() == 3 );
+  REQUIRE( parts[1].num_agents_left() == 1 );
+  REQUIRE( parts[1].agent_left(3).prefs() == std::vector<int>{4} );
+
+  SMTI::IP_Model model(&instance);
+  Matching whole = model.solve();
+  Matching joined = instance.solve_components(2);
+  REQUIRE( joined.size() == whole.size() );
+  REQUIRE( joined.has({3, 4}) );
+
+  // A sparse instance falls apart into many components, and solving them
+  // separately gives a matching of the same size.
+  SMTI sparse(60, 1, 0.5, uint64_t(9));
+  REQUIRE( sparse.components().size() > 1 );
+  SMTI::IP_Model sparse_model(&sparse);
+  REQUIRE( sparse.solve_components(0, [](SMTI::IP_Model & part) { part.merge(false); }).size() ==
+           sparse_model.solve().size() );
+}
@@ -1,5 +1,7 @@
 #include "catch.hpp"
 #include "smti.h"
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 
 TEST_CASE( "Preprocess trivial instance.", "[preprocess]" ) {
@@ -41,6 +43,21 @@ TEST_CASE( "Preprocess small instance with ties", "[preprocess]" ) {
   REQUIRE( instance.agent_right(3).num_prefs() == 1 );
 }
 
+TEST_CASE( "Preprocess instance with large IDs", "[preprocess]" ) {
+  // test-tiny.instance, with IDs far beyond the number of agents, up to the
+  // largest int.
+  std::filesystem::path filename = std::filesystem::temp_directory_path() / "smti-large-ids.instance";
+  std::ofstream(filename) << "2\n2\n100001: 100001 2147483647\n2147483647: 2147483647 100001\n"
+                          << "100001: 100001 2147483647\n2147483647: 2147483647 100001\n";
+  SMTI instance(filename.string());
+  std::filesystem::remove(filename);
+  instance.preprocess(SMTI::PreprocessMode::Complete);
+  REQUIRE( instance.agent_left(100001).num_prefs() == 1 );
+  REQUIRE( instance.agent_right(100001).num_prefs() == 1 );
+  REQUIRE( instance.agent_left(2147483647).num_prefs() == 1 );
+  REQUIRE( instance.agent_right(2147483647).num_prefs() == 1 );
+}
+
 TEST_CASE( "Preprocess trivial GRP instance.", "[preprocess]" ) {
   SMTI grp =  SMTI::create_from_GRP("grp-test-small.instance");
   REQUIRE( grp.num_agents_left() == 3 );
@@ -0,0 +1,46 @@
+#include "catch.hpp"
+#include "Stats.h"
+#include "smti.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+TEST_CASE( "Report timers and counters", "[stats]" ) {
+  Stats::reset();
+  Stats::trace(true);
+  SMTI instance("test-ties.instance");
+  instance.encodeSAT();
+  SMTI grp = SMTI::create_from_GRP("grp-test-medium.instance");
+  grp.preprocess(SMTI::Complete);
+  Stats::trace(false);
+  std::map<std::string, Stats::Timer> timers = Stats::timers();
+  if (!Stats::enabled()) {
+    REQUIRE( timers.empty() );
+    REQUIRE( Stats::counters().empty() );
+    REQUIRE( Stats::current_bytes() == 0 );
+    return;
+  }
+  REQUIRE( timers["parse"].calls == 1 );
+  REQUIRE( timers["grp_read"].calls == 1 );
+  REQUIRE( timers["encodeSAT"].calls == 1 );
+  REQUIRE( timers["make_var_map"].calls == 1 );
+  REQUIRE( timers["preprocess"].calls == 1 );
+  REQUIRE( timers["single_reduction"].calls >= 2 );
+  REQUIRE( timers["preprocess"].seconds >= timers["single_reduction"].seconds );
+  REQUIRE( Stats::counters()["augment"] > 0 );
+  REQUIRE( timers["encodeSAT"].peak_bytes > 0 );
+  REQUIRE( timers["make_var_map"].peak_bytes <= timers["encodeSAT"].peak_bytes );
+  REQUIRE( Stats::peak_bytes() >= Stats::current_bytes() );
+
+  std::filesystem::path filename = std::filesystem::temp_directory_path() / "smti-stats-test.json";
+  Stats::write_trace(filename.string());
+  std::stringstream trace;
+  trace << std::ifstream(filename).rdbuf();
+  REQUIRE( trace.str().find("\"name\": \"encodeSAT\", \"ph\": \"X\"") != std::string::npos );
+  REQUIRE( trace.str().find("\"augment\": ") != std::string::npos );
+  REQUIRE( trace.str().find("\"peak_bytes\": ") != std::string::npos );
+  std::filesystem::remove(filename);
+
+  Stats::reset();
+  REQUIRE( Stats::timers()["parse"].calls == 0 );
+}